@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <google/protobuf/arena.h>
+#include <google/protobuf/message.h>
+
+/**
+ * @brief Messages of one batch of records, allocated on a google::protobuf::Arena instead of one heap allocation
+ * per message, string and repeated field. The arena grows in blocks of blockSize, its first block is kept by the
+ * batch and reused after clear(). The arena owns the messages: pointers handed out stay valid until clear()
+ * or the destruction of the batch and must not be deleted.
+ */
+class ArenaBatch
+{
+private:
+    const google::protobuf::Message *_prototype = nullptr;
+    std::unique_ptr<char[]> _initialBlock;
+    std::unique_ptr<google::protobuf::Arena> _arena;
+    std::vector<google::protobuf::Message *> _msgs;
+    std::vector<uint64_t> _indices;
+
+public:
+    /**
+     * @param prototype e.g. from CompiledSchema::prototype, has to outlive the batch
+     */
+    explicit ArenaBatch(const google::protobuf::Message &prototype, size_t blockSize = 1024 * 1024)
+        : _prototype(&prototype), _initialBlock(new char[blockSize])
+    {
+        google::protobuf::ArenaOptions options;
+        options.start_block_size   = blockSize;
+        options.max_block_size     = blockSize;
+        options.initial_block      = _initialBlock.get();
+        options.initial_block_size = blockSize;
+        _arena                     = std::make_unique<google::protobuf::Arena>(options);
+    }
+
+    ArenaBatch(const ArenaBatch &) = delete;
+    ArenaBatch &operator=(const ArenaBatch &) = delete;
+
+    /**
+     * @brief Allocates an empty message for record index on the arena.
+     */
+    google::protobuf::Message *add(uint64_t index)
+    {
+        _msgs.push_back(_prototype->New(_arena.get()));
+        _indices.push_back(index);
+        return _msgs.back();
+    }
+
+    /**
+     * @brief Destroys all messages and frees the arena blocks except the first one.
+     */
+    void clear()
+    {
+        _msgs.clear();
+        _indices.clear();
+        _arena->Reset();
+    }
+
+    size_t size() const
+    {
+        return _msgs.size();
+    }
+
+    bool empty() const
+    {
+        return _msgs.empty();
+    }
+
+    const google::protobuf::Message &message(size_t pos) const
+    {
+        return *_msgs[pos];
+    }
+
+    google::protobuf::Message *mutableMessage(size_t pos)
+    {
+        return _msgs[pos];
+    }
+
+    uint64_t index(size_t pos) const
+    {
+        return _indices[pos];
+    }
+
+    /**
+     * @return bytes the arena currently holds, including the first block
+     */
+    uint64_t spaceAllocated() const
+    {
+        return _arena->SpaceAllocated();
+    }
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <rocksdb/status.h>
+
+#include <google/protobuf/message.h>
+
+#include <desc.pb.h>
+
+#include "dbReader.h"
+#include "workerPool.h"
+
+/**
+ * @brief Result of an asynchronous read: the value is only set if status is ok.
+ */
+template <typename T>
+struct StatusOr
+{
+    rocksdb::Status status;
+    T value{};
+
+    bool ok() const
+    {
+        return status.ok();
+    }
+};
+
+/**
+ * @brief Asynchronous point reads on a dedicated I/O pool. The pool size is the number of reads in flight, so
+ * cold reads of many requests overlap their disk latency while the callers' threads are free; further reads
+ * queue up. Errors are returned as status instead of being thrown: NotFound for a missing record, Corruption
+ * for one that can't be parsed. The reader must outlive this object, the destructor finishes the queued reads.
+ */
+class AsyncReader
+{
+private:
+    DBReader &_reader;
+    WorkerPool _pool;
+
+public:
+    /**
+     * @param concurrency reads in flight, more than the cores pay off as the threads mostly wait for I/O
+     */
+    explicit AsyncReader(DBReader &reader, size_t concurrency = 16) : _reader(reader), _pool(concurrency)
+    {
+    }
+
+    size_t concurrency() const
+    {
+        return _pool.size();
+    }
+
+    std::future<StatusOr<std::string>> ReadMsg(uint64_t index)
+    {
+        return _pool.submit([this, index]() {
+            StatusOr<std::string> result;
+            result.status = _reader.TryReadMsg(index, &result.value);
+            if (!result.ok())
+            {
+                result.value.clear();
+            }
+            return result;
+        });
+    }
+
+    /**
+     * @brief Parses the record into a new message of the prototype's type, the prototype must outlive the read.
+     */
+    std::future<StatusOr<std::unique_ptr<google::protobuf::Message>>> ReadMsg(uint64_t index, const google::protobuf::Message &prototype)
+    {
+        return _pool.submit([this, index, &prototype]() {
+            StatusOr<std::unique_ptr<google::protobuf::Message>> result;
+            std::unique_ptr<google::protobuf::Message> msg(prototype.New());
+            result.status = _reader.TryReadMsg(index, msg.get());
+            if (result.ok())
+            {
+                result.value = std::move(msg);
+            }
+            return result;
+        });
+    }
+
+    std::future<StatusOr<msgDesc>> ReadDesc(std::string key)
+    {
+        return _pool.submit([this, key = std::move(key)]() {
+            StatusOr<msgDesc> result;
+            result.status = _reader.TryReadDesc(key, &result.value);
+            if (!result.ok())
+            {
+                result.value.Clear();
+            }
+            return result;
+        });
+    }
+
+    /**
+     * @brief Issues one read per index, the futures are in the order of the indices.
+     */
+    std::vector<std::future<StatusOr<std::string>>> ReadMsgs(const std::vector<uint64_t> &indices)
+    {
+        std::vector<std::future<StatusOr<std::string>>> results;
+        results.reserve(indices.size());
+        for (uint64_t index : indices)
+        {
+            results.push_back(ReadMsg(index));
+        }
+        return results;
+    }
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/**
+ * @brief Portable count of the leading zero bits, 64 for zero. The compiler builtins are undefined for zero.
+ */
+inline int countLeadingZeros(uint64_t value)
+{
+    if (0 == value)
+    {
+        return 64;
+    }
+#ifdef _MSC_VER
+    unsigned long msb = 0;
+    _BitScanReverse64(&msb, value);
+    return 63 - static_cast<int>(msb);
+#else
+    return __builtin_clzll(value);
+#endif
+}
+
+/**
+ * @brief Portable count of the trailing zero bits, 64 for zero.
+ */
+inline int countTrailingZeros(uint64_t value)
+{
+    if (0 == value)
+    {
+        return 64;
+    }
+#ifdef _MSC_VER
+    unsigned long lsb = 0;
+    _BitScanForward64(&lsb, value);
+    return static_cast<int>(lsb);
+#else
+    return __builtin_ctzll(value);
+#endif
+}
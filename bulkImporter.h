@@ -0,0 +1,234 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <rocksdb/db.h>
+#include <rocksdb/sst_file_writer.h>
+
+#include <google/protobuf/message.h>
+
+#include <desc.pb.h>
+
+#include "dbCreator.h"
+#include "keyCodec.h"
+
+struct BulkImportOptions
+{
+    // empty: "<database path>.import", an existing directory is kept, only the importer's files are removed
+    std::filesystem::path stagingDir;
+    uint64_t targetFileSize = 256 * 1024 * 1024;
+};
+
+/**
+ * @brief Bulk load for backfilling: records and descriptions are collected in memory, sorted and written
+ * into SST files with SstFileWriter, which finish() ingests into the default and the desc column family
+ * with one atomic IngestExternalFiles call. Memtable, WAL, flushes and most compactions are bypassed.
+ * Records added for the same index replace each other, the last one wins. Nothing is visible before finish().
+ */
+class BulkImporter
+{
+private:
+    struct Entry
+    {
+        uint64_t index = 0;
+        size_t offset  = 0;
+        size_t size    = 0;
+    };
+
+    DBCreator &_creator;
+    BulkImportOptions _options;
+    std::vector<Entry> _records;
+    std::string _arena;
+    std::map<std::string, std::string> _descs;
+    std::string _buffer;
+    size_t _fileCtr = 0;
+    std::vector<std::string> _stagedFiles;
+    bool _createdDir = false;
+
+    static void check(const rocksdb::Status &status)
+    {
+        if (!status.ok())
+        {
+            throw std::invalid_argument(status.ToString());
+        }
+    }
+
+    std::string nextFile()
+    {
+        _stagedFiles.push_back((_options.stagingDir / ("import" + std::to_string(_fileCtr++) + ".sst")).string());
+        return _stagedFiles.back();
+    }
+
+    /**
+     * @brief Writes the sorted records into SST files of about targetFileSize
+     */
+    std::vector<std::string> writeRecords()
+    {
+        std::vector<std::string> files;
+        if (_records.empty())
+        {
+            return files;
+        }
+        if (!std::is_sorted(_records.begin(), _records.end(), [](const Entry &lhs, const Entry &rhs) { return lhs.index < rhs.index; }))
+        {
+            // stable, so the last of several records with the same index stays last
+            std::stable_sort(_records.begin(), _records.end(), [](const Entry &lhs, const Entry &rhs) { return lhs.index < rhs.index; });
+        }
+        rocksdb::SstFileWriter writer(rocksdb::EnvOptions(), rocksdb::Options(), _creator._db->DefaultColumnFamily());
+        bool open = false;
+        for (size_t pos = 0; pos < _records.size(); ++pos)
+        {
+            if (pos + 1 < _records.size() && _records[pos + 1].index == _records[pos].index)
+            {
+                continue;
+            }
+            if (!open)
+            {
+                files.push_back(nextFile());
+                check(writer.Open(files.back()));
+                open = true;
+            }
+            check(writer.Put(toSlice(encodeIndexKey(_records[pos].index)), rocksdb::Slice(_arena.data() + _records[pos].offset, _records[pos].size)));
+            if (writer.FileSize() >= _options.targetFileSize)
+            {
+                check(writer.Finish());
+                open = false;
+            }
+        }
+        if (open)
+        {
+            check(writer.Finish());
+        }
+        return files;
+    }
+
+    std::vector<std::string> writeDescs()
+    {
+        std::vector<std::string> files;
+        if (_descs.empty())
+        {
+            return files;
+        }
+        rocksdb::SstFileWriter writer(rocksdb::EnvOptions(), rocksdb::Options(), _creator._descHandle);
+        files.push_back(nextFile());
+        check(writer.Open(files.back()));
+        for (const auto &it : _descs)
+        {
+            check(writer.Put(it.first, it.second));
+        }
+        check(writer.Finish());
+        return files;
+    }
+
+    /**
+     * @brief Removes the files written by the importer and the staging directory if the importer created it,
+     * anything else in a caller supplied directory is left alone.
+     */
+    void removeStagingFiles()
+    {
+        std::error_code error;
+        for (const std::string &file : _stagedFiles)
+        {
+            std::filesystem::remove(file, error);
+        }
+        _stagedFiles.clear();
+        if (_createdDir)
+        {
+            // fails and keeps the directory if someone else put files into it meanwhile
+            _createdDir = !std::filesystem::remove(_options.stagingDir, error);
+        }
+    }
+
+public:
+    explicit BulkImporter(DBCreator &creator, const BulkImportOptions &options = BulkImportOptions()) : _creator(creator), _options(options)
+    {
+        if (!_creator._db)
+        {
+            throw std::invalid_argument("Bulk import needs a created database");
+        }
+        if (_options.stagingDir.empty())
+        {
+            _options.stagingDir = _creator._db->GetName() + ".import";
+        }
+    }
+
+    ~BulkImporter()
+    {
+        removeStagingFiles();
+    }
+
+    BulkImporter(const BulkImporter &) = delete;
+    BulkImporter &operator=(const BulkImporter &) = delete;
+
+    void addMsg(uint64_t index, const google::protobuf::Message *msg)
+    {
+        msg->SerializeToString(&_buffer);
+        _records.push_back({index, _arena.size(), _buffer.size()});
+        _arena.append(_buffer);
+    }
+
+    /**
+     * @brief Stored like DBCreator::writeDesc, needs the desc column.
+     */
+    void addDesc(const char *key, const msgDesc &desc)
+    {
+        if (!_creator._descHandle)
+        {
+            throw std::invalid_argument("Desc column not created");
+        }
+        DBCreator::serializeDesc(desc, _descs[key]);
+    }
+
+    size_t pendingMsgs() const
+    {
+        return _records.size();
+    }
+
+    /**
+     * @brief Writes the SST files and ingests them, records and descriptions become visible together.
+     * The staging files are removed afterwards, the importer can be used for the next import.
+     */
+    void finish()
+    {
+        _createdDir = std::filesystem::create_directories(_options.stagingDir) || _createdDir;
+        std::vector<rocksdb::IngestExternalFileArg> args;
+        std::vector<std::string> files = writeRecords();
+        if (!files.empty())
+        {
+            args.emplace_back();
+            args.back().column_family  = _creator._db->DefaultColumnFamily();
+            args.back().external_files = std::move(files);
+        }
+        files = writeDescs();
+        if (!files.empty())
+        {
+            args.emplace_back();
+            args.back().column_family  = _creator._descHandle;
+            args.back().external_files = std::move(files);
+        }
+        for (auto &arg : args)
+        {
+            // the staging files are not needed afterwards, so they can be linked instead of copied
+            arg.options.move_files = true;
+        }
+        rocksdb::Status status = args.empty() ? rocksdb::Status::OK() : _creator._db->IngestExternalFiles(args);
+        if (_creator._cache)
+        {
+            for (const Entry &record : _records)
+            {
+                _creator._cache->invalidate(record.index);
+            }
+        }
+        _records.clear();
+        _arena.clear();
+        _descs.clear();
+        removeStagingFiles();
+        check(status);
+    }
+};
@@ -0,0 +1,282 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <rocksdb/slice.h>
+
+#include "columnCodec.h"
+
+/**
+ * @brief Value layout of a chunked column family: one value holds the records of chunkSize consecutive indices.
+ * The key is the index of the first record of the chunk (a multiple of the chunk size), encoded like a record key.
+ * The value starts with a format byte, followed by the varint record count, the varint offsets of the records
+ * relative to the chunk key, the varint record sizes and finally the serialized records back to back.
+ * Offsets and sizes come first so a single record is found without walking the records in front of it.
+ *
+ * With the Columns format the varint record count is followed by the varint size and the delta of delta coded
+ * bit stream of the offsets, and the records are stored as columns by ColumnChunkCodec. Readers rebuild the
+ * records, so both formats look the same to them. Chunks the codec can't represent are stored as Records.
+ */
+enum class ChunkEncoding : uint8_t
+{
+    Records = 0,
+    Columns = 1
+};
+
+/**
+ * @brief Collects the records of one chunk. Records have to be added in ascending index order,
+ * adding the last index again replaces that record.
+ */
+class ChunkBuilder
+{
+private:
+    uint64_t _start = 0;
+    std::vector<uint32_t> _offsets;
+    std::vector<uint32_t> _sizes;
+    std::string _records;
+    std::string _value;
+    std::unique_ptr<ColumnChunkCodec> _codec;
+    std::vector<uint64_t> _wideOffsets;
+    std::string _stream;
+
+    bool finishColumns()
+    {
+        _value.clear();
+        _value.push_back(static_cast<char>(ChunkEncoding::Columns));
+        putVarint(_value, _offsets.size());
+        _wideOffsets.assign(_offsets.begin(), _offsets.end());
+        _stream.clear();
+        BitWriter out(_stream);
+        encodeDeltaOfDelta(_wideOffsets.data(), _wideOffsets.size(), out);
+        out.finish();
+        putVarint(_value, _stream.size());
+        _value.append(_stream);
+        return _codec->encode(_records.data(), _sizes, _value);
+    }
+
+public:
+    /**
+     * @brief Stores the chunks as columns of the fields of desc, see ChunkEncoding::Columns.
+     */
+    void useColumns(const google::protobuf::Descriptor *desc)
+    {
+        _codec = std::make_unique<ColumnChunkCodec>(desc);
+    }
+
+    /**
+     * @return Descriptor the chunks are column coded for, nullptr for the Records format
+     */
+    const google::protobuf::Descriptor *columnsDescriptor() const
+    {
+        return _codec ? _codec->descriptor() : nullptr;
+    }
+
+    void reset(uint64_t start)
+    {
+        _start = start;
+        _offsets.clear();
+        _sizes.clear();
+        _records.clear();
+    }
+
+    uint64_t start() const
+    {
+        return _start;
+    }
+
+    bool empty() const
+    {
+        return _offsets.empty();
+    }
+
+    size_t count() const
+    {
+        return _offsets.size();
+    }
+
+    void add(uint64_t index, const std::string &record)
+    {
+        if (index < _start || index - _start > UINT32_MAX)
+        {
+            throw std::invalid_argument("Index " + std::to_string(index) + " outside of chunk " + std::to_string(_start));
+        }
+        const uint32_t offset = static_cast<uint32_t>(index - _start);
+        if (!_offsets.empty() && offset <= _offsets.back())
+        {
+            if (offset < _offsets.back())
+            {
+                throw std::invalid_argument("Chunked records have to be appended in ascending index order");
+            }
+            _records.resize(_records.size() - _sizes.back());
+            _offsets.pop_back();
+            _sizes.pop_back();
+        }
+        _offsets.push_back(offset);
+        _sizes.push_back(static_cast<uint32_t>(record.size()));
+        _records.append(record);
+    }
+
+    /**
+     * @brief Encodes the chunk into a buffer reused between calls. The builder keeps its records,
+     * so a partially filled chunk can be written and later rewritten with more records.
+     */
+    const std::string &finish()
+    {
+        if (_codec && finishColumns())
+        {
+            return _value;
+        }
+        _value.clear();
+        _value.push_back(static_cast<char>(ChunkEncoding::Records));
+        putVarint(_value, _offsets.size());
+        for (uint32_t offset : _offsets)
+        {
+            putVarint(_value, offset);
+        }
+        for (uint32_t size : _sizes)
+        {
+            putVarint(_value, size);
+        }
+        _value.append(_records);
+        return _value;
+    }
+};
+
+/**
+ * @brief Parsed header of a chunk value, the records stay in the value and are handed out as slices.
+ * Records of a Columns chunk are rebuilt into a buffer of the view instead.
+ * The buffers are reused, so one view per reader is enough.
+ */
+class ChunkView
+{
+private:
+    std::vector<uint32_t> _offsets;
+    std::vector<const char *> _records;
+    std::vector<uint32_t> _sizes;
+    ColumnChunkCodec _codec;
+    std::vector<uint64_t> _wideOffsets;
+    std::string _rebuilt;
+
+    bool parseColumns(const char *ptr, const char *end, size_t count)
+    {
+        uint64_t size = 0;
+        if (!getVarint(ptr, end, size) || size > static_cast<uint64_t>(end - ptr))
+        {
+            return false;
+        }
+        _wideOffsets.resize(count);
+        BitReader in(ptr, size);
+        if (!decodeDeltaOfDelta(in, count, _wideOffsets.data()))
+        {
+            return false;
+        }
+        ptr += size;
+        if (!_codec.decode(ptr, end, count) || ptr != end)
+        {
+            return false;
+        }
+        _rebuilt.clear();
+        _offsets.resize(count);
+        _sizes.resize(count);
+        for (size_t row = 0; row < count; ++row)
+        {
+            if (_wideOffsets[row] > UINT32_MAX)
+            {
+                return false;
+            }
+            _offsets[row]          = static_cast<uint32_t>(_wideOffsets[row]);
+            const size_t recordPos = _rebuilt.size();
+            _codec.appendRecord(row, _rebuilt);
+            _sizes[row] = static_cast<uint32_t>(_rebuilt.size() - recordPos);
+        }
+        // pointers are taken after rebuilding, the buffer may have moved while growing
+        _records.resize(count);
+        const char *record = _rebuilt.data();
+        for (size_t row = 0; row < count; ++row)
+        {
+            _records[row]  = record;
+            record        += _sizes[row];
+        }
+        return true;
+    }
+
+public:
+    /**
+     * @return false if the value is not a valid chunk
+     */
+    bool parse(const rocksdb::Slice &value)
+    {
+        _offsets.clear();
+        _records.clear();
+        _sizes.clear();
+        const char *ptr = value.data();
+        const char *end = value.data() + value.size();
+        uint64_t count  = 0;
+        if (ptr == end)
+        {
+            return false;
+        }
+        const ChunkEncoding encoding = static_cast<ChunkEncoding>(*ptr++);
+        if ((encoding != ChunkEncoding::Records && encoding != ChunkEncoding::Columns) || !getVarint(ptr, end, count) || count > value.size() * 8)
+        {
+            return false;
+        }
+        if (encoding == ChunkEncoding::Columns)
+        {
+            return parseColumns(ptr, end, count);
+        }
+        _offsets.resize(count);
+        _sizes.resize(count);
+        for (std::vector<uint32_t> *column : {&_offsets, &_sizes})
+        {
+            for (uint32_t &entry : *column)
+            {
+                uint64_t varint = 0;
+                if (!getVarint(ptr, end, varint) || varint > UINT32_MAX)
+                {
+                    return false;
+                }
+                entry = static_cast<uint32_t>(varint);
+            }
+        }
+        _records.resize(count);
+        for (size_t pos = 0; pos < count; ++pos)
+        {
+            if (static_cast<uint64_t>(end - ptr) < _sizes[pos])
+            {
+                return false;
+            }
+            _records[pos] = ptr;
+            ptr += _sizes[pos];
+        }
+        return ptr == end;
+    }
+
+    size_t size() const
+    {
+        return _offsets.size();
+    }
+
+    uint32_t offset(size_t pos) const
+    {
+        return _offsets[pos];
+    }
+
+    rocksdb::Slice record(size_t pos) const
+    {
+        return rocksdb::Slice(_records[pos], _sizes[pos]);
+    }
+
+    /**
+     * @return position of the first record with an offset not below the given one, size() if there is none
+     */
+    size_t lowerBound(uint32_t offset) const
+    {
+        return static_cast<size_t>(std::lower_bound(_offsets.begin(), _offsets.end(), offset) - _offsets.begin());
+    }
+};
@@ -0,0 +1,658 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <google/protobuf/descriptor.h>
+
+#include "bitOps.h"
+
+inline void putVarint(std::string &dst, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        dst.push_back(static_cast<char>((value & 0x7F) | 0x80));
+        value >>= 7;
+    }
+    dst.push_back(static_cast<char>(value));
+}
+
+inline bool getVarint(const char *&ptr, const char *end, uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && ptr < end; shift += 7)
+    {
+        const uint8_t byte = static_cast<uint8_t>(*ptr++);
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (byte < 0x80)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline size_t varintSize(uint64_t value)
+{
+    size_t size = 1;
+    for (; value >= 0x80; value >>= 7)
+    {
+        ++size;
+    }
+    return size;
+}
+
+/**
+ * @brief Appends bit fields most significant bit first, the last byte is padded with zeros by finish().
+ */
+class BitWriter
+{
+private:
+    std::string &_dst;
+    uint64_t _acc = 0;
+    int _used     = 0;
+
+public:
+    explicit BitWriter(std::string &dst) : _dst(dst)
+    {
+    }
+
+    /**
+     * @brief Writes the lowest bits (1..64) of value
+     */
+    void write(uint64_t value, int bits)
+    {
+        while (bits > 0)
+        {
+            const int take       = std::min(bits, 64 - _used);
+            const uint64_t part  = (value >> (bits - take)) & (take == 64 ? ~uint64_t(0) : (uint64_t(1) << take) - 1);
+            _acc                 = take == 64 ? part : (_acc << take) | part;
+            _used               += take;
+            bits                -= take;
+            if (64 == _used)
+            {
+                for (int shift = 56; shift >= 0; shift -= 8)
+                {
+                    _dst.push_back(static_cast<char>(_acc >> shift));
+                }
+                _acc  = 0;
+                _used = 0;
+            }
+        }
+    }
+
+    void finish()
+    {
+        for (int shift = _used - 8; shift > -8; shift -= 8)
+        {
+            _dst.push_back(static_cast<char>(shift >= 0 ? _acc >> shift : _acc << -shift));
+        }
+        _acc  = 0;
+        _used = 0;
+    }
+};
+
+/**
+ * @brief Reads the bit fields of a BitWriter. The next bits are kept left aligned in a 64 bit window,
+ * which is refilled bytewise when it runs low.
+ */
+class BitReader
+{
+private:
+    const uint8_t *_ptr;
+    const uint8_t *_end;
+    uint64_t _window = 0;
+    int _bits        = 0;
+
+    void refill()
+    {
+        while (_bits <= 56 && _ptr < _end)
+        {
+            _window |= static_cast<uint64_t>(*_ptr++) << (56 - _bits);
+            _bits   += 8;
+        }
+    }
+
+public:
+    BitReader(const char *data, size_t size)
+        : _ptr(reinterpret_cast<const uint8_t *>(data)), _end(reinterpret_cast<const uint8_t *>(data) + size)
+    {
+    }
+
+    /**
+     * @brief Reads bits (1..64) into the lowest bits of value
+     * @return false at the end of the stream
+     */
+    bool read(int bits, uint64_t &value)
+    {
+        if (bits > 56)
+        {
+            uint64_t high = 0;
+            uint64_t low  = 0;
+            if (!read(bits - 32, high) || !read(32, low))
+            {
+                return false;
+            }
+            value = (high << 32) | low;
+            return true;
+        }
+        if (_bits < bits)
+        {
+            refill();
+            if (_bits < bits)
+            {
+                return false;
+            }
+        }
+        value     = _window >> (64 - bits);
+        _window <<= bits;
+        _bits    -= bits;
+        return true;
+    }
+
+    /**
+     * @brief Reads a prefix of up to max (1..8) one bits, terminated by a zero bit unless max ones were read.
+     * @return false at the end of the stream
+     */
+    bool readOnes(int max, int &ones)
+    {
+        refill();
+        ones             = std::min(countLeadingZeros(~_window), max);
+        const int length = ones < max ? ones + 1 : ones;
+        if (_bits < length)
+        {
+            return false;
+        }
+        _window <<= length;
+        _bits    -= length;
+        return true;
+    }
+};
+
+inline uint64_t zigzagEncode(int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t zigzagDecode(uint64_t value)
+{
+    return static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1));
+}
+
+/**
+ * @brief Delta of delta coding for integer columns, like the timestamps in Gorilla (Pelkonen et al., VLDB 2015).
+ * A column growing by a constant step takes one bit per value. The zigzag encoded delta of delta is stored
+ * with a prefix selecting the width: '0' for 0, '10' + 7 bits, '110' + 12 bits, '1110' + 20 bits, '1111' + 64 bits.
+ * The arithmetic wraps, so any 64 bit pattern round trips.
+ */
+inline void encodeDeltaOfDelta(const uint64_t *values, size_t count, BitWriter &out)
+{
+    uint64_t prev      = 0;
+    uint64_t prevDelta = 0;
+    for (size_t pos = 0; pos < count; ++pos)
+    {
+        const uint64_t delta = values[pos] - prev;
+        const uint64_t zz    = zigzagEncode(static_cast<int64_t>(delta - prevDelta));
+        if (0 == zz)
+        {
+            out.write(0, 1);
+        }
+        else if (zz < (uint64_t(1) << 7))
+        {
+            out.write((uint64_t(0b10) << 7) | zz, 9);
+        }
+        else if (zz < (uint64_t(1) << 12))
+        {
+            out.write((uint64_t(0b110) << 12) | zz, 15);
+        }
+        else if (zz < (uint64_t(1) << 20))
+        {
+            out.write((uint64_t(0b1110) << 20) | zz, 24);
+        }
+        else
+        {
+            out.write(0b1111, 4);
+            out.write(zz, 64);
+        }
+        prev      = values[pos];
+        prevDelta = delta;
+    }
+}
+
+inline bool decodeDeltaOfDelta(BitReader &in, size_t count, uint64_t *values)
+{
+    uint64_t prev      = 0;
+    uint64_t prevDelta = 0;
+    for (size_t pos = 0; pos < count; ++pos)
+    {
+        int prefix = 0;
+        if (!in.readOnes(4, prefix))
+        {
+            return false;
+        }
+        static constexpr int widths[] = {0, 7, 12, 20, 64};
+        uint64_t zz                   = 0;
+        if (prefix > 0 && !in.read(widths[prefix], zz))
+        {
+            return false;
+        }
+        prevDelta   += static_cast<uint64_t>(zigzagDecode(zz));
+        prev        += prevDelta;
+        values[pos]  = prev;
+    }
+    return true;
+}
+
+/**
+ * @brief XOR coding of floating point bit patterns as in Gorilla. Equal neighbours take one bit, otherwise the
+ * meaningful bits of the XOR are stored, reusing the previous leading/trailing zero window if they fit in it:
+ * '0' for equal, '10' + bits in the previous window, '11' + 6 bits leading zeros + 6 bits length - 1 + bits.
+ */
+inline void encodeXor(const uint64_t *values, size_t count, BitWriter &out)
+{
+    uint64_t prev = 0;
+    int prevLead  = -1;
+    int prevLen   = 0;
+    for (size_t pos = 0; pos < count; ++pos)
+    {
+        const uint64_t x = values[pos] ^ prev;
+        prev             = values[pos];
+        if (0 == x)
+        {
+            out.write(0, 1);
+            continue;
+        }
+        const int lead  = std::min(countLeadingZeros(x), 63);
+        const int trail = countTrailingZeros(x);
+        if (prevLead >= 0 && lead >= prevLead && trail >= 64 - prevLead - prevLen)
+        {
+            out.write(0b10, 2);
+            out.write(x >> (64 - prevLead - prevLen), prevLen);
+        }
+        else
+        {
+            prevLead = lead;
+            prevLen  = 64 - lead - trail;
+            out.write((uint64_t(0b11) << 12) | (static_cast<uint64_t>(lead) << 6) | static_cast<uint64_t>(prevLen - 1), 14);
+            out.write(x >> trail, prevLen);
+        }
+    }
+}
+
+inline bool decodeXor(BitReader &in, size_t count, uint64_t *values)
+{
+    uint64_t prev = 0;
+    int prevLead  = -1;
+    int prevLen   = 0;
+    for (size_t pos = 0; pos < count; ++pos)
+    {
+        int ones = 0;
+        if (!in.readOnes(2, ones))
+        {
+            return false;
+        }
+        if (ones > 0)
+        {
+            if (2 == ones)
+            {
+                uint64_t window = 0;
+                if (!in.read(12, window))
+                {
+                    return false;
+                }
+                prevLead = static_cast<int>(window >> 6);
+                prevLen  = static_cast<int>(window & 0x3F) + 1;
+                if (prevLead + prevLen > 64)
+                {
+                    return false;
+                }
+            }
+            else if (prevLead < 0)
+            {
+                return false;
+            }
+            uint64_t x = 0;
+            if (!in.read(prevLen, x))
+            {
+                return false;
+            }
+            prev ^= x << (64 - prevLead - prevLen);
+        }
+        values[pos] = prev;
+    }
+    return true;
+}
+
+/**
+ * @brief Column coding of the records of one chunk, see ChunkEncoding::Columns.
+ * Works on the wire format of flat proto3 records: every field has to be a singular scalar or enum without
+ * presence, so a field missing on the wire is the same as 0. The records are split into one column per field,
+ * floating point columns use XOR coding, all others delta of delta. Column numbers and types are stored with
+ * the columns, so decoding and rebuilding the records needs no Descriptor, and the rebuilt records are byte
+ * identical to the ones written by SerializeToString.
+ *
+ * Layout: varint column count, per column varint field number and field type byte, then per column the varint
+ * size of its bit stream followed by the stream.
+ */
+class ColumnChunkCodec
+{
+private:
+    struct Column
+    {
+        uint32_t number = 0;
+        google::protobuf::FieldDescriptor::Type type{};
+    };
+
+    // Beyond this field number the table would be mostly holes, such schemas keep the records format
+    static constexpr int maxTableNumber = 1024;
+
+    const google::protobuf::Descriptor *_desc = nullptr;
+    std::vector<Column> _columns;
+    std::vector<int32_t> _table;
+    std::vector<std::vector<uint64_t>> _values;
+    std::string _stream;
+
+    static uint32_t wireType(google::protobuf::FieldDescriptor::Type type)
+    {
+        using google::protobuf::FieldDescriptor;
+        switch (type)
+        {
+        case FieldDescriptor::TYPE_FIXED32:
+        case FieldDescriptor::TYPE_SFIXED32:
+        case FieldDescriptor::TYPE_FLOAT:
+            return 5;
+        case FieldDescriptor::TYPE_FIXED64:
+        case FieldDescriptor::TYPE_SFIXED64:
+        case FieldDescriptor::TYPE_DOUBLE:
+            return 1;
+        default:
+            return 0;
+        }
+    }
+
+    static bool isFloating(google::protobuf::FieldDescriptor::Type type)
+    {
+        return type == google::protobuf::FieldDescriptor::TYPE_FLOAT || type == google::protobuf::FieldDescriptor::TYPE_DOUBLE;
+    }
+
+    /**
+     * @brief Wire value to column value: sint fields are zigzag decoded and 32 bit signed values sign extended,
+     * so the deltas of small negative numbers stay small.
+     */
+    static uint64_t toColumn(google::protobuf::FieldDescriptor::Type type, uint64_t raw)
+    {
+        using google::protobuf::FieldDescriptor;
+        switch (type)
+        {
+        case FieldDescriptor::TYPE_SINT32:
+            return static_cast<uint64_t>(static_cast<int64_t>(static_cast<int32_t>(zigzagDecode(static_cast<uint32_t>(raw)))));
+        case FieldDescriptor::TYPE_SINT64:
+            return static_cast<uint64_t>(zigzagDecode(raw));
+        case FieldDescriptor::TYPE_SFIXED32:
+            return static_cast<uint64_t>(static_cast<int64_t>(static_cast<int32_t>(raw)));
+        default:
+            return raw;
+        }
+    }
+
+    static uint64_t toWire(google::protobuf::FieldDescriptor::Type type, uint64_t value)
+    {
+        using google::protobuf::FieldDescriptor;
+        switch (type)
+        {
+        case FieldDescriptor::TYPE_SINT32:
+            return zigzagEncode(static_cast<int32_t>(value)) & 0xFFFFFFFF;
+        case FieldDescriptor::TYPE_SINT64:
+            return zigzagEncode(static_cast<int64_t>(value));
+        case FieldDescriptor::TYPE_SFIXED32:
+            return value & 0xFFFFFFFF;
+        default:
+            return value;
+        }
+    }
+
+    /**
+     * @brief Splits one record into row of the columns.
+     * @return false if the record would not be rebuilt byte identical
+     */
+    bool splitRecord(const char *ptr, const char *end, size_t row)
+    {
+        for (auto &column : _values)
+        {
+            column[row] = 0;
+        }
+        uint64_t prevNumber = 0;
+        while (ptr < end)
+        {
+            const char *start = ptr;
+            uint64_t tag      = 0;
+            if (!getVarint(ptr, end, tag) || static_cast<size_t>(ptr - start) != varintSize(tag))
+            {
+                return false;
+            }
+            const uint64_t number = tag >> 3;
+            if (number <= prevNumber || number >= _table.size() || _table[number] < 0)
+            {
+                return false;
+            }
+            prevNumber          = number;
+            const Column &entry = _columns[_table[number]];
+            if ((tag & 7) != wireType(entry.type))
+            {
+                return false;
+            }
+            uint64_t raw = 0;
+            if (0 == (tag & 7))
+            {
+                start = ptr;
+                if (!getVarint(ptr, end, raw) || static_cast<size_t>(ptr - start) != varintSize(raw))
+                {
+                    return false;
+                }
+            }
+            else
+            {
+                const size_t width = 5 == (tag & 7) ? 4 : 8;
+                if (static_cast<size_t>(end - ptr) < width)
+                {
+                    return false;
+                }
+                for (size_t pos = 0; pos < width; ++pos)
+                {
+                    raw |= static_cast<uint64_t>(static_cast<uint8_t>(ptr[pos])) << (8 * pos);
+                }
+                ptr += width;
+            }
+            // proto3 does not write zero values
+            if (0 == raw)
+            {
+                return false;
+            }
+            _values[_table[number]][row] = toColumn(entry.type, raw);
+        }
+        return true;
+    }
+
+public:
+    ColumnChunkCodec() = default;
+
+    /**
+     * @brief Prepares the codec for records of desc. Check supported() before encoding.
+     */
+    explicit ColumnChunkCodec(const google::protobuf::Descriptor *desc) : _desc(desc)
+    {
+        using google::protobuf::FieldDescriptor;
+        for (int idx = 0; idx < desc->field_count(); ++idx)
+        {
+            const FieldDescriptor *field = desc->field(idx);
+            if (field->is_repeated() || field->has_presence() || field->cpp_type() == FieldDescriptor::CPPTYPE_STRING ||
+                field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE || field->number() > maxTableNumber)
+            {
+                _columns.clear();
+                _desc = nullptr;
+                return;
+            }
+            _columns.push_back({static_cast<uint32_t>(field->number()), field->type()});
+        }
+        std::sort(_columns.begin(), _columns.end(), [](const Column &lhs, const Column &rhs) { return lhs.number < rhs.number; });
+        _table.assign(_columns.empty() ? 1 : _columns.back().number + 1, -1);
+        for (size_t pos = 0; pos < _columns.size(); ++pos)
+        {
+            _table[_columns[pos].number] = static_cast<int32_t>(pos);
+        }
+    }
+
+    bool supported() const
+    {
+        return nullptr != _desc;
+    }
+
+    const google::protobuf::Descriptor *descriptor() const
+    {
+        return _desc;
+    }
+
+    /**
+     * @brief Appends the columns of the records to dst. records holds sizes.size() records back to back.
+     * @return false if a record can not be column coded, dst is left unchanged then
+     */
+    bool encode(const char *records, const std::vector<uint32_t> &sizes, std::string &dst)
+    {
+        if (!supported())
+        {
+            return false;
+        }
+        _values.resize(_columns.size());
+        for (auto &column : _values)
+        {
+            column.resize(sizes.size());
+        }
+        for (size_t row = 0; row < sizes.size(); ++row)
+        {
+            if (!splitRecord(records, records + sizes[row], row))
+            {
+                return false;
+            }
+            records += sizes[row];
+        }
+
+        putVarint(dst, _columns.size());
+        for (const Column &column : _columns)
+        {
+            putVarint(dst, column.number);
+            dst.push_back(static_cast<char>(column.type));
+        }
+        for (size_t pos = 0; pos < _columns.size(); ++pos)
+        {
+            _stream.clear();
+            BitWriter out(_stream);
+            if (isFloating(_columns[pos].type))
+            {
+                encodeXor(_values[pos].data(), sizes.size(), out);
+            }
+            else
+            {
+                encodeDeltaOfDelta(_values[pos].data(), sizes.size(), out);
+            }
+            out.finish();
+            putVarint(dst, _stream.size());
+            dst.append(_stream);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Decodes the columns of count records written by encode. Afterwards column(pos) holds
+     * the values of the field number(pos) in column representation.
+     * @return false if the data is not valid
+     */
+    bool decode(const char *&ptr, const char *end, size_t count)
+    {
+        using google::protobuf::FieldDescriptor;
+        uint64_t numColumns = 0;
+        if (!getVarint(ptr, end, numColumns) || numColumns > static_cast<uint64_t>(end - ptr))
+        {
+            return false;
+        }
+        _columns.resize(numColumns);
+        for (Column &column : _columns)
+        {
+            uint64_t number = 0;
+            if (!getVarint(ptr, end, number) || ptr == end || number > (uint64_t(1) << 29))
+            {
+                return false;
+            }
+            column.number = static_cast<uint32_t>(number);
+            column.type   = static_cast<FieldDescriptor::Type>(static_cast<uint8_t>(*ptr++));
+            if (column.type < 1 || column.type > FieldDescriptor::MAX_TYPE)
+            {
+                return false;
+            }
+        }
+        _values.resize(numColumns);
+        for (size_t pos = 0; pos < numColumns; ++pos)
+        {
+            uint64_t size = 0;
+            if (!getVarint(ptr, end, size) || size > static_cast<uint64_t>(end - ptr))
+            {
+                return false;
+            }
+            _values[pos].resize(count);
+            BitReader in(ptr, size);
+            const bool ok = isFloating(_columns[pos].type) ? decodeXor(in, count, _values[pos].data())
+                                                           : decodeDeltaOfDelta(in, count, _values[pos].data());
+            if (!ok)
+            {
+                return false;
+            }
+            ptr += size;
+        }
+        return true;
+    }
+
+    size_t columns() const
+    {
+        return _columns.size();
+    }
+
+    uint32_t number(size_t pos) const
+    {
+        return _columns[pos].number;
+    }
+
+    const std::vector<uint64_t> &column(size_t pos) const
+    {
+        return _values[pos];
+    }
+
+    /**
+     * @brief Appends the protobuf encoding of row of the decoded columns to dst
+     */
+    void appendRecord(size_t row, std::string &dst) const
+    {
+        for (size_t pos = 0; pos < _columns.size(); ++pos)
+        {
+            const uint64_t value = _values[pos][row];
+            if (0 == value)
+            {
+                continue;
+            }
+            const uint32_t type = wireType(_columns[pos].type);
+            putVarint(dst, (static_cast<uint64_t>(_columns[pos].number) << 3) | type);
+            const uint64_t raw = toWire(_columns[pos].type, value);
+            if (0 == type)
+            {
+                putVarint(dst, raw);
+            }
+            else
+            {
+                for (size_t byte = 0; byte < (5 == type ? 4u : 8u); ++byte)
+                {
+                    dst.push_back(static_cast<char>(raw >> (8 * byte)));
+                }
+            }
+        }
+    }
+};
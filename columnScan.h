@@ -0,0 +1,133 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Struct of arrays view of a scanned key range: one contiguous column per slot of a RowDecoder.
+ * columns[slot][row] belongs to the record indices[row].
+ */
+template <typename T>
+struct ColumnBatch
+{
+    std::vector<uint64_t> indices;
+    std::vector<std::vector<T>> columns;
+
+    size_t size() const
+    {
+        return indices.size();
+    }
+
+    void clear()
+    {
+        indices.clear();
+        for (auto &column : columns)
+        {
+            column.clear();
+        }
+    }
+};
+
+// The kernels below are plain loops over contiguous memory without data dependent branches,
+// so the compiler can vectorize them. Sums use several independent accumulators, otherwise
+// floating point sums could not be reordered into vector lanes.
+
+template <typename T>
+using ColumnAccumulator = std::conditional_t<std::is_floating_point_v<T>, double, std::conditional_t<std::is_signed_v<T>, int64_t, uint64_t>>;
+
+template <typename T>
+ColumnAccumulator<T> columnSum(const T *data, size_t count)
+{
+    ColumnAccumulator<T> acc[4] = {};
+    size_t pos                  = 0;
+    for (; pos + 4 <= count; pos += 4)
+    {
+        acc[0] += data[pos];
+        acc[1] += data[pos + 1];
+        acc[2] += data[pos + 2];
+        acc[3] += data[pos + 3];
+    }
+    for (; pos < count; ++pos)
+    {
+        acc[0] += data[pos];
+    }
+    return (acc[0] + acc[1]) + (acc[2] + acc[3]);
+}
+
+template <typename T>
+std::pair<T, T> columnMinMax(const T *data, size_t count)
+{
+    T lo = std::numeric_limits<T>::max();
+    T hi = std::numeric_limits<T>::lowest();
+    for (size_t pos = 0; pos < count; ++pos)
+    {
+        lo = std::min(lo, data[pos]);
+        hi = std::max(hi, data[pos]);
+    }
+    return {lo, hi};
+}
+
+/**
+ * @brief Number of values in [lo, hi)
+ */
+template <typename T>
+size_t columnCount(const T *data, size_t count, T lo, T hi)
+{
+    size_t matches = 0;
+    for (size_t pos = 0; pos < count; ++pos)
+    {
+        matches += static_cast<size_t>((data[pos] >= lo) & (data[pos] < hi));
+    }
+    return matches;
+}
+
+/**
+ * @brief Adds the values in [lo, hi) to bins.size() equally wide bins, values outside are ignored.
+ */
+template <typename T>
+void columnHistogram(const T *data, size_t count, T lo, T hi, std::vector<uint64_t> &bins)
+{
+    if (bins.empty() || !(lo < hi))
+    {
+        throw std::invalid_argument("Invalid histogram range");
+    }
+    const double scale = static_cast<double>(bins.size()) / (static_cast<double>(hi) - static_cast<double>(lo));
+    const size_t last  = bins.size() - 1;
+    for (size_t pos = 0; pos < count; ++pos)
+    {
+        if (data[pos] >= lo && data[pos] < hi)
+        {
+            const size_t bin = static_cast<size_t>((static_cast<double>(data[pos]) - static_cast<double>(lo)) * scale);
+            ++bins[std::min(bin, last)];
+        }
+    }
+}
+
+template <typename T>
+struct ColumnStats
+{
+    size_t count = 0;
+    ColumnAccumulator<T> sum{};
+    T min = std::numeric_limits<T>::max();
+    T max = std::numeric_limits<T>::lowest();
+
+    double mean() const
+    {
+        return count ? static_cast<double>(sum) / static_cast<double>(count) : 0.0;
+    }
+};
+
+template <typename T>
+ColumnStats<T> columnStats(const std::vector<T> &column)
+{
+    ColumnStats<T> stats;
+    stats.count                    = column.size();
+    stats.sum                      = columnSum(column.data(), column.size());
+    std::tie(stats.min, stats.max) = columnMinMax(column.data(), column.size());
+    return stats;
+}
@@ -0,0 +1,1109 @@
+#include <algorithm>
+#include <catch2/catch.hpp>
+#include <chrono>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <thread>
+
+#include "arenaBatch.h"
+#include "asyncReader.h"
+#include "bulkImporter.h"
+#include "dbCreator.h"
+#include "dbReader.h"
+#include "fieldPlan.h"
+#include "ingestPipeline.h"
+#include "liveTail.h"
+#include "messageCreator.h"
+#include "recordCache.h"
+#include "rollup.h"
+#include "rowDecoder.h"
+#include "scanFilter.h"
+#include "typedStore.h"
+#include "workerPool.h"
+
+namespace
+{
+constexpr const char *recorderText = R"(syntax = "proto3";
+message recorder_1
+{
+    uint32 oltc = 1;
+    int32 voltage = 2;
+    int32 current = 3;
+})";
+constexpr uint32_t numRecords      = 10000;
+
+/**
+ * @brief Per operation latencies of one workload plus the records and bytes it processed.
+ * BENCHMARK only reports means, the percentiles need every single sample.
+ */
+struct Measurement
+{
+    std::vector<double> latencies;
+    size_t records = 0;
+    size_t bytes   = 0;
+    double seconds = 0;
+};
+
+/**
+ * @brief Runs op(pos) for pos in [0, ops), timing every call. op returns the number of bytes it processed.
+ */
+template <typename Op>
+Measurement measure(size_t ops, size_t recordsPerOp, Op &&op)
+{
+    Measurement result;
+    result.latencies.reserve(ops);
+    for (size_t pos = 0; pos < ops; ++pos)
+    {
+        const auto start                            = std::chrono::steady_clock::now();
+        result.bytes                               += op(pos);
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        result.latencies.push_back(elapsed.count());
+        result.seconds += elapsed.count();
+    }
+    result.records = ops * recordsPerOp;
+    return result;
+}
+
+void report(const std::string &workload, Measurement &result)
+{
+    std::sort(result.latencies.begin(), result.latencies.end());
+    const auto percentile = [&result](double rank) {
+        return result.latencies.empty() ? 0.0 : result.latencies[static_cast<size_t>(rank * (result.latencies.size() - 1))] * 1e6;
+    };
+    std::cout << std::left << std::setw(64) << workload << std::right << std::fixed << std::setprecision(0) << std::setw(12)
+              << result.records / result.seconds << " rec/s" << std::setprecision(2) << std::setw(10) << result.bytes / result.seconds / 1e6
+              << " MB/s" << std::setw(10) << percentile(0.5) << " us p50" << std::setw(10) << percentile(0.99) << " us p99" << std::endl;
+}
+
+/**
+ * @brief Schema with width int32 fields, so the cost per field becomes visible
+ */
+std::string wideSchemaText(size_t width)
+{
+    std::string text = "syntax = \"proto3\";\nmessage wide\n{\n";
+    for (size_t field = 1; field <= width; ++field)
+    {
+        text += "    int32 field" + std::to_string(field) + " = " + std::to_string(field) + ";\n";
+    }
+    return text + "}";
+}
+} // namespace
+
+struct benchFixture
+{
+    const std::string filepath = "./databaseBench.db";
+    MessageCreator msgCreator;
+    const google::protobuf::Descriptor *recorderDesc = nullptr;
+    std::unique_ptr<google::protobuf::Message> msg;
+
+    benchFixture()
+    {
+        if (std::filesystem::exists(filepath))
+        {
+            std::filesystem::remove_all(filepath);
+        }
+        recorderDesc = msgCreator.createMessageDesc(recorderText, "recorder_1");
+        msg = msgCreator.createNewMessage(recorderDesc);
+        const google::protobuf::Reflection *reflection = msg->GetReflection();
+        reflection->SetUInt32(msg.get(), recorderDesc->FindFieldByName("oltc"), 3);
+        reflection->SetInt32(msg.get(), recorderDesc->FindFieldByName("voltage"), 23000);
+        reflection->SetInt32(msg.get(), recorderDesc->FindFieldByName("current"), -120);
+    }
+
+    void fill(uint32_t count = numRecords)
+    {
+        DBCreator creator;
+        creator.create(filepath);
+        creator.createNewColumn("desc");
+        for (uint32_t ctr = 0; ctr < count; ++ctr)
+        {
+            creator.appendMsg(ctr, msg.get());
+        }
+    }
+};
+
+TEST_CASE_METHOD(benchFixture, "Ingest throughput")
+{
+    DBCreator creator;
+    creator.create(filepath);
+    creator.createNewColumn("desc");
+
+    BENCHMARK("writeMsg, one Put per record")
+    {
+        for (uint32_t ctr = 0; ctr < numRecords; ++ctr)
+        {
+            creator.writeMsg(ctr, msg.get());
+        }
+    };
+
+    BENCHMARK("appendMsg, group commit")
+    {
+        for (uint32_t ctr = 0; ctr < numRecords; ++ctr)
+        {
+            creator.appendMsg(ctr, msg.get());
+        }
+        creator.flush();
+    };
+
+    BulkImporter importer(creator);
+    BENCHMARK("BulkImporter, SST files and ingestion")
+    {
+        for (uint32_t ctr = 0; ctr < numRecords; ++ctr)
+        {
+            importer.addMsg(ctr, msg.get());
+        }
+        importer.finish();
+    };
+}
+
+TEST_CASE_METHOD(benchFixture, "Read throughput")
+{
+    fill();
+    DBReader reader;
+    reader.Open(filepath);
+
+    BENCHMARK("ReadMsg, copy and ParseFromString")
+    {
+        for (uint32_t ctr = 0; ctr < numRecords; ++ctr)
+        {
+            msg->ParseFromString(reader.ReadMsg(ctr));
+        }
+    };
+
+    BENCHMARK("ReadMsg, parse from pinned value")
+    {
+        for (uint32_t ctr = 0; ctr < numRecords; ++ctr)
+        {
+            reader.ReadMsg(ctr, msg.get());
+        }
+    };
+
+    BENCHMARK("ReadRange, parse from iterator value")
+    {
+        return reader.ReadRange(0, numRecords, msg.get(), [](uint64_t, const google::protobuf::Message &) {});
+    };
+}
+
+TEST_CASE_METHOD(benchFixture, "Scattered point lookups")
+{
+    constexpr uint32_t numStored = 200000;
+    fill(numStored);
+    DBReader reader;
+    reader.Open(filepath);
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<uint64_t> distrib(0, numStored - 1);
+    for (size_t numKeys : {1000, 10000, 100000})
+    {
+        std::vector<uint64_t> indices(numKeys);
+        std::generate(indices.begin(), indices.end(), [&]() { return distrib(gen); });
+        std::vector<rocksdb::PinnableSlice> values;
+
+        BENCHMARK("ReadMsg loop, " + std::to_string(numKeys) + " keys")
+        {
+            for (uint64_t index : indices)
+            {
+                reader.ReadMsg(index, msg.get());
+            }
+        };
+
+        BENCHMARK("ReadMany, " + std::to_string(numKeys) + " keys")
+        {
+            return reader.ReadMany(indices, values);
+        };
+    }
+}
+
+TEST_CASE_METHOD(benchFixture, "Schema open")
+{
+    const std::string fileProto = SchemaCache::instance().fromText(recorderText)->fileDescriptorProto();
+
+    BENCHMARK("Parser and BuildFile, uncached")
+    {
+        return std::make_shared<CompiledSchema>(parseSchemaText(recorderText));
+    };
+
+    BENCHMARK("BuildFile from FileDescriptorProto, uncached")
+    {
+        google::protobuf::FileDescriptorProto proto;
+        proto.ParseFromString(fileProto);
+        return std::make_shared<CompiledSchema>(proto);
+    };
+
+    BENCHMARK("SchemaCache hit")
+    {
+        return SchemaCache::instance().fromFileDescriptorProto(fileProto);
+    };
+}
+
+TEST_CASE_METHOD(benchFixture, "Field access")
+{
+    const FieldPlan<uint32_t, int32_t, int32_t> plan(recorderDesc, {"oltc", "voltage", "current"});
+
+    BENCHMARK("FindFieldByName and Reflection per record")
+    {
+        const google::protobuf::Reflection *reflection = msg->GetReflection();
+        for (uint32_t ctr = 0; ctr < numRecords; ++ctr)
+        {
+            reflection->SetUInt32(msg.get(), recorderDesc->FindFieldByName("oltc"), ctr);
+            reflection->SetInt32(msg.get(), recorderDesc->FindFieldByName("voltage"), 23000);
+            reflection->SetInt32(msg.get(), recorderDesc->FindFieldByName("current"), -120);
+        }
+    };
+
+    BENCHMARK("FieldPlan fill")
+    {
+        for (uint32_t ctr = 0; ctr < numRecords; ++ctr)
+        {
+            plan.fill(msg.get(), std::make_tuple(ctr, 23000, -120));
+        }
+    };
+}
+
+TEST_CASE_METHOD(benchFixture, "Record decode")
+{
+    std::vector<std::string> records(numRecords);
+    const FieldPlan<uint32_t, int32_t, int32_t> plan(recorderDesc, {"oltc", "voltage", "current"});
+    for (uint32_t ctr = 0; ctr < numRecords; ++ctr)
+    {
+        plan.fill(msg.get(), std::make_tuple(ctr, static_cast<int32_t>(ctr * 31), -static_cast<int32_t>(ctr)));
+        msg->SerializeToString(&records[ctr]);
+    }
+
+    BENCHMARK("ParseFromString and Reflection")
+    {
+        int64_t sum = 0;
+        const google::protobuf::Reflection *reflection = msg->GetReflection();
+        for (const std::string &record : records)
+        {
+            msg->ParseFromString(record);
+            sum += reflection->GetUInt32(*msg, plan.field(0)) + reflection->GetInt32(*msg, plan.field(1)) + reflection->GetInt32(*msg, plan.field(2));
+        }
+        return sum;
+    };
+
+    RowDecoder decoder(*msg);
+    BENCHMARK("RowDecoder, flat wire decode")
+    {
+        int64_t sum = 0;
+        std::array<int64_t, 3> row;
+        for (const std::string &record : records)
+        {
+            decoder.decode(record.data(), record.size(), row.data());
+            sum += row[0] + row[1] + row[2];
+        }
+        return sum;
+    };
+}
+
+TEST_CASE_METHOD(benchFixture, "Measurement aggregation")
+{
+    fill();
+    DBReader reader;
+    reader.Open(filepath);
+    const FieldPlan<uint32_t, int32_t, int32_t> plan(recorderDesc, {"oltc", "voltage", "current"});
+
+    BENCHMARK("Parse and Reflection per record")
+    {
+        int64_t sum     = 0;
+        int32_t maximum = std::numeric_limits<int32_t>::lowest();
+        reader.ReadRange(0, numRecords, msg.get(), [&](uint64_t, const google::protobuf::Message &record) {
+            const int32_t voltage = plan.get<1>(record);
+            sum += voltage;
+            maximum = std::max(maximum, voltage);
+        });
+        return sum + maximum;
+    };
+
+    RowDecoder decoder(*msg);
+    ColumnBatch<int32_t> batch;
+    BENCHMARK("Columnar scan and kernels")
+    {
+        batch.clear();
+        reader.ReadColumns(0, numRecords, decoder, batch);
+        const ColumnStats<int32_t> voltage = columnStats(batch.columns[1]);
+        return voltage.sum + voltage.max;
+    };
+}
+
+TEST_CASE_METHOD(benchFixture, "Chunked layout")
+{
+    constexpr uint64_t chunkSizes[] = {16, 256};
+    const google::protobuf::FieldDescriptor *voltage = recorderDesc->FindFieldByName("voltage");
+    {
+        DBCreator creator;
+        creator.create(filepath);
+        creator.createNewColumn("desc");
+        for (uint64_t chunkSize : chunkSizes)
+        {
+            creator.createChunkedColumn(("chunks" + std::to_string(chunkSize)).c_str(), chunkSize);
+        }
+        for (uint32_t ctr = 0; ctr < numRecords; ++ctr)
+        {
+            msg->GetReflection()->SetInt32(msg.get(), voltage, 23000 + static_cast<int32_t>(ctr % 50));
+            creator.appendMsg(ctr, msg.get());
+            for (uint64_t chunkSize : chunkSizes)
+            {
+                creator.appendChunkedMsg(("chunks" + std::to_string(chunkSize)).c_str(), ctr, msg.get());
+            }
+        }
+    }
+    DBReader reader;
+    reader.Open(filepath);
+    std::cout << "bytes/record, one key per record: " << static_cast<double>(reader.ColumnBytes("default")) / numRecords << std::endl;
+    for (uint64_t chunkSize : chunkSizes)
+    {
+        std::cout << "bytes/record, " << chunkSize
+                  << " records per chunk: " << static_cast<double>(reader.ColumnBytes("chunks" + std::to_string(chunkSize))) / numRecords
+                  << std::endl;
+    }
+
+    BENCHMARK("ReadRange, one key per record")
+    {
+        return reader.ReadRange(0, numRecords, msg.get(), [](uint64_t, const google::protobuf::Message &) {});
+    };
+
+    BENCHMARK("ReadChunkedRange, 16 records per chunk")
+    {
+        return reader.ReadChunkedRange("chunks16", 0, numRecords, [&](uint64_t, const rocksdb::Slice &value) {
+            msg->ParseFromArray(value.data(), static_cast<int>(value.size()));
+        });
+    };
+
+    BENCHMARK("ReadChunkedRange, 256 records per chunk")
+    {
+        return reader.ReadChunkedRange("chunks256", 0, numRecords, [&](uint64_t, const rocksdb::Slice &value) {
+            msg->ParseFromArray(value.data(), static_cast<int>(value.size()));
+        });
+    };
+}
+
+TEST_CASE_METHOD(benchFixture, "Column coded chunks")
+{
+    constexpr uint64_t chunkSize = 256;
+    const FieldPlan<uint32_t, int32_t, int32_t> plan(recorderDesc, {"oltc", "voltage", "current"});
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int32_t> noise(-20, 20);
+    std::vector<ChunkBuilder> chunks(numRecords / chunkSize + 1);
+    size_t recordBytes = 0;
+    {
+        DBCreator creator;
+        creator.create(filepath);
+        creator.createNewColumn("desc");
+        creator.createChunkedColumn("records", chunkSize);
+        creator.createChunkedColumn("columns", chunkSize, ChunkEncoding::Columns);
+        std::string record;
+        for (uint32_t ctr = 0; ctr < numRecords; ++ctr)
+        {
+            // slowly changing recorder values
+            plan.fill(msg.get(), std::make_tuple(ctr / 1000, 23000 + noise(gen), 400 + noise(gen)));
+            creator.appendMsg(ctr, msg.get());
+            creator.appendChunkedMsg("records", ctr, msg.get());
+            creator.appendChunkedMsg("columns", ctr, msg.get());
+
+            ChunkBuilder &chunk = chunks[ctr / chunkSize];
+            if (chunk.empty())
+            {
+                chunk.reset(ctr - ctr % chunkSize);
+                chunk.useColumns(recorderDesc);
+            }
+            msg->SerializeToString(&record);
+            chunk.add(ctr, record);
+            recordBytes += record.size();
+        }
+    }
+    {
+        DBReader reader;
+        reader.Open(filepath);
+        const double plain = static_cast<double>(reader.ColumnBytes("default"));
+        std::cout << "compression ratio against one key per record, records per chunk: " << plain / static_cast<double>(reader.ColumnBytes("records"))
+                  << ", column coded chunks: " << plain / static_cast<double>(reader.ColumnBytes("columns")) << std::endl;
+    }
+
+    std::vector<std::string> values;
+    size_t valueBytes = 0;
+    for (ChunkBuilder &chunk : chunks)
+    {
+        values.push_back(chunk.finish());
+        valueBytes += values.back().size();
+    }
+    std::cout << "protobuf bytes/record: " << static_cast<double>(recordBytes) / numRecords
+              << ", column coded bytes/record: " << static_cast<double>(valueBytes) / numRecords << std::endl;
+
+    // decode throughput in protobuf record bytes produced per second
+    ChunkView view;
+    constexpr int rounds = 50;
+    const auto start     = std::chrono::steady_clock::now();
+    size_t decoded       = 0;
+    for (int round = 0; round < rounds; ++round)
+    {
+        for (const std::string &value : values)
+        {
+            view.parse(value);
+            decoded += view.size();
+        }
+    }
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << "column decode: " << static_cast<double>(recordBytes) * rounds / elapsed.count() / 1e9 << " GB/s, " << decoded << " records"
+              << std::endl;
+
+    BENCHMARK("ChunkView, column coded chunks")
+    {
+        size_t count = 0;
+        for (const std::string &value : values)
+        {
+            view.parse(value);
+            count += view.size();
+        }
+        return count;
+    };
+}
+
+TEST_CASE_METHOD(benchFixture, "Ingest pipeline")
+{
+    constexpr uint32_t numProducers = 4;
+    DBCreator creator;
+    creator.create(filepath);
+    creator.createNewColumn("desc");
+
+    BENCHMARK("appendMsg, one thread")
+    {
+        for (uint32_t ctr = 0; ctr < numProducers * numRecords; ++ctr)
+        {
+            creator.appendMsg(ctr, msg.get());
+        }
+        creator.flush();
+    };
+
+    for (size_t writerThreads : {1, 2})
+    {
+        IngestOptions options;
+        options.writerThreads = writerThreads;
+        IngestPipeline pipeline(creator, options);
+        BENCHMARK(std::to_string(numProducers) + " producers, " + std::to_string(writerThreads) + " writer threads")
+        {
+            std::vector<std::thread> producers;
+            for (uint32_t producer = 0; producer < numProducers; ++producer)
+            {
+                producers.emplace_back([&, producer]() {
+                    std::unique_ptr<google::protobuf::Message> record(msg->New());
+                    record->CopyFrom(*msg);
+                    for (uint32_t ctr = 0; ctr < numRecords; ++ctr)
+                    {
+                        pipeline.push(producer * numRecords + ctr, record.get());
+                    }
+                });
+            }
+            for (auto &producer : producers)
+            {
+                producer.join();
+            }
+            pipeline.flush();
+        };
+        const IngestStats stats = pipeline.stats();
+        std::cout << writerThreads << " writer threads: " << stats.batches << " batches, max queue depth " << stats.maxQueueDepth << ", producer waits "
+                  << stats.producerWaits << ", mean latency " << stats.meanLatency.count() / 1000 << " us, max latency "
+                  << stats.maxLatency.count() / 1000 << " us" << std::endl;
+    }
+}
+
+TEST_CASE_METHOD(benchFixture, "Parallel aggregation")
+{
+    constexpr uint32_t count = 10 * numRecords;
+    fill(count);
+    DBReader reader;
+    reader.Open(filepath);
+    RowDecoder sequential(*msg);
+    const int voltage = sequential.slot("voltage");
+    ColumnBatch<int32_t> batch;
+
+    BENCHMARK("ReadColumns, one thread")
+    {
+        batch.clear();
+        reader.ReadColumns(0, count, sequential, batch);
+        return columnStats(batch.columns[voltage]).sum;
+    };
+
+    WorkerPool pool;
+    BENCHMARK("ReadColumnsParallel, " + std::to_string(pool.size()) + " threads")
+    {
+        batch.clear();
+        reader.ReadColumnsParallel(0, count, pool, pool.size(), *msg, batch);
+        return columnStats(batch.columns[voltage]).sum;
+    };
+
+    struct Partial
+    {
+        RowDecoder decoder;
+        int64_t sum = 0;
+    };
+    BENCHMARK("ReadRangeParallel with reducer, " + std::to_string(pool.size()) + " threads")
+    {
+        int64_t sum = 0;
+        reader.ReadRangeParallel(
+            0, count, pool, 4 * pool.size(), [&]() { return Partial{RowDecoder(*msg), 0}; },
+            [voltage](Partial &partial, uint64_t, const rocksdb::Slice &value) {
+                std::array<int32_t, 3> row;
+                partial.decoder.decode(value.data(), value.size(), row.data());
+                partial.sum += row[voltage];
+            },
+            [&sum](Partial &&partial) { sum += partial.sum; });
+        return sum;
+    };
+}
+
+TEST_CASE_METHOD(benchFixture, "Arena batch decode")
+{
+    constexpr uint32_t numEvents    = 100000;
+    constexpr const char *eventText = R"(syntax = "proto3";
+message event
+{
+    string source = 1;
+    repeated int32 samples = 2;
+    repeated string tags = 3;
+})";
+    const google::protobuf::Descriptor *eventDesc = msgCreator.createMessageDesc(eventText, "event");
+    {
+        std::unique_ptr<google::protobuf::Message> event = msgCreator.createNewMessage(eventDesc);
+        const google::protobuf::Reflection *reflection   = event->GetReflection();
+        reflection->SetString(event.get(), eventDesc->FindFieldByName("source"), "substation transformer 7");
+        for (int32_t sample = 0; sample < 16; ++sample)
+        {
+            reflection->AddInt32(event.get(), eventDesc->FindFieldByName("samples"), sample * 1000);
+        }
+        reflection->AddString(event.get(), eventDesc->FindFieldByName("tags"), "phase L1");
+        reflection->AddString(event.get(), eventDesc->FindFieldByName("tags"), "tap change");
+        DBCreator creator;
+        creator.create(filepath);
+        for (uint32_t ctr = 0; ctr < numEvents; ++ctr)
+        {
+            creator.appendMsg(ctr, event.get());
+        }
+    }
+    DBReader reader;
+    reader.Open(filepath);
+
+    BENCHMARK("ReadRange, heap message per record")
+    {
+        size_t ctr = 0;
+        reader.ReadRange(0, numEvents, [&](uint64_t, const rocksdb::Slice &value) {
+            std::unique_ptr<google::protobuf::Message> event = msgCreator.createNewMessage(eventDesc);
+            ctr += event->ParseFromArray(value.data(), static_cast<int>(value.size()));
+        });
+        return ctr;
+    };
+
+    BENCHMARK("ReadRange, one reused message")
+    {
+        std::unique_ptr<google::protobuf::Message> event = msgCreator.createNewMessage(eventDesc);
+        return reader.ReadRange(0, numEvents, event.get(), [](uint64_t, const google::protobuf::Message &) {});
+    };
+
+    ArenaBatch batch(msgCreator.prototype(eventDesc), 4 * 1024 * 1024);
+    uint64_t arenaBytes = 0;
+    BENCHMARK("ReadBatches, arena messages, 10000 per batch")
+    {
+        return reader.ReadBatches(0, numEvents, batch, 10000,
+                                  [&arenaBytes](const ArenaBatch &decoded) { arenaBytes = std::max(arenaBytes, decoded.spaceAllocated()); });
+    };
+    std::cout << "arena bytes per batch: " << arenaBytes << std::endl;
+}
+
+TEST_CASE_METHOD(benchFixture, "Hot record lookups")
+{
+    fill();
+    DBReader reader;
+    reader.Open(filepath);
+    const google::protobuf::Message &prototype = msgCreator.prototype(recorderDesc);
+    // the most recent 100 records, requested over and over
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<uint64_t> distrib(numRecords - 100, numRecords - 1);
+    std::vector<uint64_t> indices(numRecords);
+    std::generate(indices.begin(), indices.end(), [&]() { return distrib(gen); });
+
+    BENCHMARK("ReadMsg, parse every time")
+    {
+        for (uint64_t index : indices)
+        {
+            reader.ReadMsg(index, msg.get());
+        }
+    };
+
+    BENCHMARK("ReadCachedMsg, no cache")
+    {
+        for (uint64_t index : indices)
+        {
+            reader.ReadCachedMsg(index, prototype);
+        }
+    };
+
+    auto cache = std::make_shared<RecordCache>(16 * 1024 * 1024);
+    reader.setRecordCache(cache);
+    BENCHMARK("ReadCachedMsg, decoded record cache")
+    {
+        for (uint64_t index : indices)
+        {
+            reader.ReadCachedMsg(index, prototype);
+        }
+    };
+    const RecordCacheStats stats = cache->stats();
+    std::cout << "record cache hits: " << stats.hits << " misses: " << stats.misses << std::endl;
+}
+
+TEST_CASE_METHOD(benchFixture, "Typed records")
+{
+    constexpr uint32_t numTypes = 16;
+    std::vector<uint32_t> ids;
+    {
+        DBCreator creator;
+        creator.create(filepath);
+        creator.createNewColumn("desc");
+        creator.createTypedColumn();
+        std::vector<std::unique_ptr<google::protobuf::Message>> msgs;
+        for (uint32_t type = 0; type < numTypes; ++type)
+        {
+            // same fields, distinct message types
+            const std::string name = "recorder_" + std::to_string(type + 1);
+            std::string text(recorderText);
+            text.replace(text.find("recorder_1"), 10, name);
+            ids.push_back(creator.registerSchema(text.c_str(), name.c_str()));
+            const google::protobuf::Descriptor *desc = msgCreator.createMessageDesc(text.c_str(), name.c_str());
+            msgs.push_back(msgCreator.createNewMessage(desc));
+        }
+        // interleaved, as recorders of one site write concurrently
+        for (uint32_t ctr = 0; ctr < numRecords; ++ctr)
+        {
+            for (uint32_t type = 0; type < numTypes; ++type)
+            {
+                creator.appendTypedMsg(ids[type], ctr, msgs[type].get());
+            }
+        }
+    }
+    DBReader reader;
+    reader.Open(filepath);
+    const uint32_t id = ids[numTypes / 2];
+
+    BENCHMARK("ReadTypedRange, one of " + std::to_string(numTypes) + " types")
+    {
+        return reader.ReadTypedRange(id, 0, numRecords, [](uint64_t, const rocksdb::Slice &) {});
+    };
+
+    std::unique_ptr<google::protobuf::Message> typed = reader.ReadTypedMsg(id, 0);
+    BENCHMARK("ReadTypedMsg, one of " + std::to_string(numTypes) + " types")
+    {
+        for (uint32_t ctr = 0; ctr < numRecords; ++ctr)
+        {
+            reader.ReadTypedMsg(id, ctr, typed.get());
+        }
+    };
+}
+
+TEST_CASE_METHOD(benchFixture, "Selective scan")
+{
+    constexpr uint32_t numScanned = 100000;
+    {
+        DBCreator creator;
+        creator.create(filepath);
+        const google::protobuf::Reflection *reflection = msg->GetReflection();
+        for (uint32_t ctr = 0; ctr < numScanned; ++ctr)
+        {
+            reflection->SetInt32(msg.get(), recorderDesc->FindFieldByName("voltage"), static_cast<int32_t>(ctr % 100));
+            creator.appendMsg(ctr, msg.get());
+        }
+    }
+    DBReader reader;
+    reader.Open(filepath);
+    const google::protobuf::FieldDescriptor *oltc    = recorderDesc->FindFieldByName("oltc");
+    const google::protobuf::FieldDescriptor *voltage = recorderDesc->FindFieldByName("voltage");
+    // 1% of the records match
+    ScanFilter filter(recorderDesc);
+    filter.where("voltage", CompareOp::GreaterEqual, 99).where("oltc", CompareOp::Equal, 3u);
+
+    BENCHMARK("ReadRange, parse and compare every record")
+    {
+        size_t ctr = 0;
+        reader.ReadRange(0, numScanned, msg.get(), [&](uint64_t, const google::protobuf::Message &record) {
+            const google::protobuf::Reflection *reflection = record.GetReflection();
+            ctr += reflection->GetInt32(record, voltage) >= 99 && 3 == reflection->GetUInt32(record, oltc);
+        });
+        return ctr;
+    };
+
+    BENCHMARK("ReadRangeFiltered, parse matching records only")
+    {
+        return reader.ReadRangeFiltered(0, numScanned, filter, msg.get(), [](uint64_t, const google::protobuf::Message &) {});
+    };
+}
+
+TEST_CASE_METHOD(benchFixture, "Rollup queries")
+{
+    constexpr uint32_t numSamples = 100000;
+    // one sample per 10 ms
+    constexpr uint64_t endTime = 10ull * numSamples;
+    {
+        DBCreator creator;
+        creator.create(filepath);
+        creator.createTimeIndexColumn();
+        creator.createRollupColumns();
+        const google::protobuf::Reflection *reflection = msg->GetReflection();
+        for (uint32_t ctr = 0; ctr < numSamples; ++ctr)
+        {
+            reflection->SetInt32(msg.get(), recorderDesc->FindFieldByName("voltage"), static_cast<int32_t>(ctr % 1000));
+            creator.appendMsg(ctr, 10ull * ctr, msg.get());
+        }
+    }
+    DBReader reader;
+    reader.Open(filepath);
+    RowDecoder decoder(*msg);
+    const int voltage = decoder.slot("voltage");
+
+    BENCHMARK("ReadTimeRange, max voltage of every raw sample")
+    {
+        std::vector<double> row(decoder.size());
+        double max = 0;
+        reader.ReadTimeRange(0, endTime, [&](uint64_t, uint64_t, const rocksdb::Slice &value) {
+            decoder.decode(value.data(), value.size(), row.data());
+            max = std::max(max, row[voltage]);
+        });
+        return max;
+    };
+
+    BENCHMARK("ReadRollups, max voltage, 1000 point budget")
+    {
+        double max = 0;
+        reader.ReadRollups(0, endTime, 1000, [&](const RollupBucket &bucket) { max = std::max(max, bucket.fields[voltage].max); });
+        return max;
+    };
+}
+
+TEST_CASE_METHOD(benchFixture, "Generated messages")
+{
+    msgDesc desc;
+    desc.set_starttimestamp(1700000000000);
+    desc.set_endtimestamp(1700000360000);
+    desc.set_measurement(7);
+    desc.set_measdescription("substation transformer 7");
+    const std::string schemaText                    = msgDesc::descriptor()->file()->DebugString();
+    const google::protobuf::Descriptor *dynamicDesc = msgCreator.createMessageDesc(schemaText.c_str(), "msgDesc");
+    std::unique_ptr<google::protobuf::Message> dynamic(msgCreator.createNewMessage(dynamicDesc));
+    REQUIRE(dynamic->ParseFromString(desc.SerializeAsString()));
+
+    {
+        DBCreator creator;
+        creator.create(filepath);
+        TypedStore<msgDesc, IndexKeyCodec> store = creator.typedStore<msgDesc, IndexKeyCodec>();
+
+        BENCHMARK("writeMsg, DynamicMessage")
+        {
+            for (uint32_t ctr = 0; ctr < numRecords; ++ctr)
+            {
+                creator.writeMsg(ctr, dynamic.get());
+            }
+        };
+
+        BENCHMARK("TypedStore::put, generated msgDesc")
+        {
+            for (uint32_t ctr = 0; ctr < numRecords; ++ctr)
+            {
+                store.put(ctr, desc);
+            }
+        };
+    }
+
+    // the creator is closed, its records are flushed
+    DBReader reader;
+    reader.Open(filepath);
+    TypedStore<msgDesc, IndexKeyCodec> readStore = reader.OpenTypedStore<msgDesc, IndexKeyCodec>();
+
+    BENCHMARK("ReadMsg, DynamicMessage")
+    {
+        for (uint32_t ctr = 0; ctr < numRecords; ++ctr)
+        {
+            reader.ReadMsg(ctr, dynamic.get());
+        }
+    };
+
+    BENCHMARK("TypedStore::get, generated msgDesc")
+    {
+        for (uint32_t ctr = 0; ctr < numRecords; ++ctr)
+        {
+            readStore.get(ctr, desc);
+        }
+    };
+
+    const google::protobuf::FieldDescriptor *measurement = dynamicDesc->FindFieldByName("measurement");
+    BENCHMARK("ReadRange, DynamicMessage, Reflection")
+    {
+        uint64_t sum = 0;
+        reader.ReadRange(0, numRecords, dynamic.get(), [&](uint64_t, const google::protobuf::Message &record) {
+            sum += record.GetReflection()->GetUInt32(record, measurement);
+        });
+        return sum;
+    };
+
+    BENCHMARK("TypedStore::scan, generated accessors")
+    {
+        uint64_t sum = 0;
+        readStore.scan(0, numRecords, desc, [&sum](uint64_t, const msgDesc &record) { sum += record.measurement(); });
+        return sum;
+    };
+}
+
+TEST_CASE_METHOD(benchFixture, "Async point reads")
+{
+    fill();
+    DBReader reader;
+    reader.Open(filepath);
+    std::vector<uint64_t> indices(numRecords);
+    std::iota(indices.begin(), indices.end(), 0);
+    std::shuffle(indices.begin(), indices.end(), std::mt19937(42));
+
+    BENCHMARK("ReadMsg, blocking, one thread")
+    {
+        size_t bytes = 0;
+        for (uint64_t index : indices)
+        {
+            bytes += reader.ReadMsg(index).size();
+        }
+        return bytes;
+    };
+
+    // from memory the pool only adds its hand over per read, the overlap pays off with reads waiting for the disk
+    for (size_t concurrency : {4u, 16u})
+    {
+        AsyncReader async(reader, concurrency);
+        BENCHMARK("AsyncReader::ReadMsgs, " + std::to_string(concurrency) + " in flight")
+        {
+            size_t bytes = 0;
+            for (auto &future : async.ReadMsgs(indices))
+            {
+                bytes += future.get().value.size();
+            }
+            return bytes;
+        };
+    }
+}
+
+TEST_CASE_METHOD(benchFixture, "Metrics overhead")
+{
+    fill();
+    DBReader reader;
+    reader.Open(filepath);
+
+    BENCHMARK("ReadMsg, metrics off")
+    {
+        for (uint32_t ctr = 0; ctr < numRecords; ++ctr)
+        {
+            reader.ReadMsg(ctr, msg.get());
+        }
+    };
+
+    reader.metrics().setEnabled(true);
+    BENCHMARK("ReadMsg, latency histograms")
+    {
+        for (uint32_t ctr = 0; ctr < numRecords; ++ctr)
+        {
+            reader.ReadMsg(ctr, msg.get());
+        }
+    };
+
+    DBMetrics::capturePerfContext(true);
+    BENCHMARK("ReadMsg, latency histograms and perf context")
+    {
+        for (uint32_t ctr = 0; ctr < numRecords; ++ctr)
+        {
+            reader.ReadMsg(ctr, msg.get());
+        }
+    };
+    std::cout << reader.metrics().snapshot().toJson() << std::endl;
+    DBMetrics::capturePerfContext(false);
+}
+
+TEST_CASE_METHOD(benchFixture, "Live tail latency")
+{
+    constexpr uint32_t numTailed = 2000;
+    DBCreator creator;
+    creator.create(filepath);
+    // the secondary follows the WAL
+    BatchOptions batchOptions;
+    batchOptions.disableWAL = false;
+    creator.setBatchOptions(batchOptions);
+    creator.writeMsg(0, msg.get());
+    DBReader reader;
+    reader.OpenAsSecondary(filepath);
+
+    uint64_t next = 1;
+    for (int interval : {1, 10})
+    {
+        std::vector<std::chrono::steady_clock::time_point> written(numTailed);
+        std::vector<std::chrono::steady_clock::time_point> delivered(numTailed);
+        std::atomic<uint32_t> ctr{0};
+        const uint64_t offset = next;
+        next += numTailed;
+        TailOptions options;
+        options.pollInterval = std::chrono::milliseconds(interval);
+        LiveTail tail(reader, options);
+        tail.subscribe(offset, [&](uint64_t index, const rocksdb::Slice &) {
+            delivered[index - offset] = std::chrono::steady_clock::now();
+            ++ctr;
+        });
+        for (uint32_t pos = 0; pos < numTailed; ++pos)
+        {
+            written[pos] = std::chrono::steady_clock::now();
+            creator.writeMsg(offset + pos, msg.get());
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (ctr < numTailed && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        REQUIRE(numTailed == ctr);
+        Measurement result;
+        for (uint32_t pos = 0; pos < numTailed; ++pos)
+        {
+            const std::chrono::duration<double> latency = delivered[pos] - written[pos];
+            result.latencies.push_back(latency.count());
+        }
+        result.records = numTailed;
+        result.seconds = std::chrono::duration<double>(delivered.back() - written.front()).count();
+        report("LiveTail, write to callback, poll every " + std::to_string(interval) + " ms", result);
+    }
+}
+
+TEST_CASE("Workloads")
+{
+    const uint32_t count = GENERATE(1000u, 10000u);
+    const size_t width   = GENERATE(3u, 32u);
+    const std::string filepath = "./databaseWorkload.db";
+    const std::string params   = std::to_string(count) + " records, " + std::to_string(width) + " fields: ";
+
+    MessageCreator msgCreator;
+    const google::protobuf::Descriptor *desc = msgCreator.createMessageDesc(wideSchemaText(width).c_str(), "wide");
+    std::unique_ptr<google::protobuf::Message> msg(msgCreator.createNewMessage(desc));
+    std::mt19937 gen(1);
+    std::uniform_int_distribution<int32_t> values(-100000, 100000);
+    for (int field = 0; field < desc->field_count(); ++field)
+    {
+        msg->GetReflection()->SetInt32(msg.get(), desc->field(field), values(gen));
+    }
+    const size_t recordBytes = msg->ByteSizeLong();
+
+    // writes: one Put per record and group commits of several batch sizes, with and without WAL
+    {
+        std::filesystem::remove_all(filepath);
+        DBCreator creator;
+        creator.create(filepath);
+        creator.createNewColumn("desc");
+        Measurement result = measure(count, 1, [&](size_t pos) {
+            creator.writeMsg(pos, msg.get());
+            return recordBytes;
+        });
+        report(params + "writeMsg", result);
+    }
+    for (size_t batchSize : {100u, 1000u})
+    {
+        for (bool disableWAL : {true, false})
+        {
+            std::filesystem::remove_all(filepath);
+            DBCreator creator;
+            creator.create(filepath);
+            creator.createNewColumn("desc");
+            BatchOptions options;
+            options.maxCount   = batchSize;
+            options.disableWAL = disableWAL;
+            creator.setBatchOptions(options);
+            Measurement result = measure(count, 1, [&](size_t pos) {
+                creator.appendMsg(pos, msg.get());
+                return recordBytes;
+            });
+            creator.flush();
+            report(params + "appendMsg, batch " + std::to_string(batchSize) + (disableWAL ? ", no WAL" : ", WAL"), result);
+        }
+    }
+
+    // reads in random order; cold reads come from a freshly opened database with an empty block cache,
+    // the OS page cache is not dropped
+    std::vector<uint64_t> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), gen);
+    for (bool warm : {false, true})
+    {
+        DBReader reader;
+        reader.Open(filepath);
+        if (warm)
+        {
+            reader.ReadRange(0, count, [](uint64_t, const rocksdb::Slice &) {});
+        }
+        Measurement result = measure(count, 1, [&](size_t pos) {
+            reader.ReadMsg(order[pos], msg.get());
+            return recordBytes;
+        });
+        report(params + "ReadMsg, " + (warm ? "warm" : "cold"), result);
+    }
+
+    // range scans of 100 records, latency per scan
+    {
+        DBReader reader;
+        reader.Open(filepath);
+        constexpr uint32_t scanLength = 100;
+        Measurement result = measure(count / scanLength, scanLength, [&](size_t pos) {
+            size_t bytes = 0;
+            reader.ReadRange(pos * scanLength, (pos + 1) * scanLength, [&bytes](uint64_t, const rocksdb::Slice &value) { bytes += value.size(); });
+            return bytes;
+        });
+        report(params + "ReadRange, " + std::to_string(scanLength) + " records", result);
+    }
+
+    // dynamic message parsing alone
+    {
+        std::string record;
+        msg->SerializeToString(&record);
+        Measurement result = measure(count, 1, [&](size_t) {
+            msg->ParseFromString(record);
+            return record.size();
+        });
+        report(params + "ParseFromString", result);
+    }
+    std::filesystem::remove_all(filepath);
+}
+
+TEST_CASE("Key encoding")
+{
+    // raw rocksdb, as DBCreator always uses the big endian index keys
+    const std::string filepath = "./databaseKeys.db";
+    const std::string value(16, 'x');
+    for (bool bigEndian : {true, false})
+    {
+        std::filesystem::remove_all(filepath);
+        rocksdb::Options options;
+        options.create_if_missing = true;
+        options.info_log_level    = rocksdb::FATAL_LEVEL;
+        rocksdb::DB *db           = nullptr;
+        REQUIRE(rocksdb::DB::Open(options, filepath, &db).ok());
+        const auto key = [bigEndian](size_t index) {
+            return bigEndian ? std::string(encodeIndexKey(index).data(), sizeof(uint64_t)) : std::to_string(index);
+        };
+        const std::string name = bigEndian ? "big endian keys: " : "decimal text keys: ";
+        rocksdb::WriteOptions writeOptions;
+        writeOptions.disableWAL = true;
+        Measurement result      = measure(numRecords, 1, [&](size_t pos) {
+            db->Put(writeOptions, key(pos), value);
+            return value.size();
+        });
+        report(name + "Put", result);
+
+        // the text keys are not sorted numerically, so an index range is no key range
+        std::string found;
+        result = measure(numRecords, 1, [&](size_t pos) {
+            db->Get(rocksdb::ReadOptions(), key(pos), &found);
+            return found.size();
+        });
+        report(name + "Get", result);
+        delete db;
+    }
+    std::filesystem::remove_all(filepath);
+}
@@ -0,0 +1,2001 @@
+#include <atomic>
+#include <catch2/catch.hpp>
+#include <filesystem>
+#include <numeric>
+#include <random>
+#include <thread>
+
+#include "arenaBatch.h"
+#include "asyncReader.h"
+#include "bulkImporter.h"
+#include "columnScan.h"
+#include "dbCreator.h"
+#include "dbMetrics.h"
+#include "dbReader.h"
+#include "fieldPlan.h"
+#include "ingestPipeline.h"
+#include "liveTail.h"
+#include "messageCreator.h"
+#include "recordCache.h"
+#include "retention.h"
+#include "rollup.h"
+#include "rowDecoder.h"
+#include "scanFilter.h"
+#include "schemaRegistry.h"
+#include "typedStore.h"
+
+namespace
+{
+constexpr const char *recorderText = R"(syntax = "proto3";
+message recorder_1
+{
+    uint32 oltc = 1;
+    int32 voltage = 2;
+    int32 current = 3;
+})";
+
+void setRecorderValues(google::protobuf::Message *msg, uint32_t oltc, int32_t voltage, int32_t current)
+{
+    const google::protobuf::Descriptor *desc      = msg->GetDescriptor();
+    const google::protobuf::Reflection *reflection = msg->GetReflection();
+    reflection->SetUInt32(msg, desc->FindFieldByName("oltc"), oltc);
+    reflection->SetInt32(msg, desc->FindFieldByName("voltage"), voltage);
+    reflection->SetInt32(msg, desc->FindFieldByName("current"), current);
+}
+} // namespace
+
+struct databaseFixture
+{
+    const std::string filepath = "./databaseTester.db";
+    MessageCreator msgCreator;
+    const google::protobuf::Descriptor *recorderDesc = nullptr;
+
+    databaseFixture()
+    {
+        if (std::filesystem::exists(filepath))
+        {
+            REQUIRE(0 < std::filesystem::remove_all(filepath));
+        }
+        recorderDesc = msgCreator.createMessageDesc(recorderText, "recorder_1");
+        REQUIRE(recorderDesc);
+    }
+};
+
+TEST_CASE_METHOD(databaseFixture, "Batched ingest")
+{
+    std::unique_ptr<google::protobuf::Message> msg(msgCreator.createNewMessage(recorderDesc));
+    WHEN("I append less messages than the count threshold")
+    {
+        {
+            DBCreator creator;
+            creator.create(filepath);
+            creator.createNewColumn("desc");
+            BatchOptions options;
+            options.maxCount = 10;
+            options.maxDelay = std::chrono::hours(1);
+            creator.setBatchOptions(options);
+            for (uint32_t ctr = 0; ctr < 25; ++ctr)
+            {
+                setRecorderValues(msg.get(), ctr, -static_cast<int32_t>(ctr), 2 * ctr);
+                creator.appendMsg(ctr, msg.get());
+            }
+            THEN("Only the remainder is still pending")
+            {
+                CHECK(5 == creator.pendingMsgs());
+                creator.flush();
+                CHECK(0 == creator.pendingMsgs());
+            }
+        }
+        THEN("All messages are readable after the creator is gone")
+        {
+            DBReader reader;
+            reader.Open(filepath);
+            for (uint32_t ctr = 0; ctr < 25; ++ctr)
+            {
+                REQUIRE(msg->ParseFromString(reader.ReadMsg(ctr)));
+                const google::protobuf::Reflection *reflection = msg->GetReflection();
+                CHECK(ctr == reflection->GetUInt32(*msg, recorderDesc->FindFieldByName("oltc")));
+                CHECK(static_cast<int32_t>(2 * ctr) == reflection->GetInt32(*msg, recorderDesc->FindFieldByName("current")));
+            }
+        }
+    }
+}
+
+TEST_CASE("Index key encoding")
+{
+    WHEN("I encode indices")
+    {
+        THEN("The bytewise order matches the numeric order")
+        {
+            CHECK(toSlice(encodeIndexKey(2)).compare(toSlice(encodeIndexKey(10))) < 0);
+            CHECK(toSlice(encodeIndexKey(255)).compare(toSlice(encodeIndexKey(256))) < 0);
+            CHECK(toSlice(encodeIndexKey(1ull << 40)).compare(toSlice(encodeIndexKey(std::numeric_limits<uint64_t>::max()))) < 0);
+        }
+        THEN("Decoding returns the original index")
+        {
+            for (uint64_t index : std::initializer_list<uint64_t>{0, 1, 255, 256, 123456789012, std::numeric_limits<uint64_t>::max()})
+            {
+                const IndexKey key = encodeIndexKey(index);
+                CHECK(index == decodeIndexKey(toSlice(key)));
+            }
+        }
+    }
+    WHEN("I encode typed keys")
+    {
+        THEN("They sort by schema id first")
+        {
+            CHECK(toSlice(encodeTypedKey(1, std::numeric_limits<uint64_t>::max())).compare(toSlice(encodeTypedKey(2, 0))) < 0);
+            CHECK(toSlice(encodeTypedKey(2, 255)).compare(toSlice(encodeTypedKey(2, 256))) < 0);
+            const TypedKey key = encodeTypedKey(70000, 123456789012);
+            CHECK(std::make_pair(uint32_t(70000), uint64_t(123456789012)) == decodeTypedKey(toSlice(key)));
+        }
+    }
+}
+
+TEST_CASE_METHOD(databaseFixture, "Range scan")
+{
+    std::unique_ptr<google::protobuf::Message> msg(msgCreator.createNewMessage(recorderDesc));
+    {
+        DBCreator creator;
+        creator.create(filepath);
+        creator.createNewColumn("desc");
+        for (uint32_t ctr = 0; ctr < 30; ++ctr)
+        {
+            setRecorderValues(msg.get(), ctr, 0, 0);
+            creator.appendMsg(ctr, msg.get());
+        }
+    }
+    DBReader reader;
+    reader.Open(filepath);
+    WHEN("I read a range crossing a decimal digit boundary")
+    {
+        std::vector<uint64_t> indices;
+        const size_t numRead = reader.ReadRange(8, 21, [&](uint64_t index, const rocksdb::Slice &value) {
+            REQUIRE(msg->ParseFromArray(value.data(), static_cast<int>(value.size())));
+            CHECK(index == msg->GetReflection()->GetUInt32(*msg, recorderDesc->FindFieldByName("oltc")));
+            indices.push_back(index);
+        });
+        THEN("I get exactly the requested indices in ascending order")
+        {
+            std::vector<uint64_t> expected(13);
+            std::iota(expected.begin(), expected.end(), 8);
+            CHECK(13 == numRead);
+            CHECK(expected == indices);
+        }
+    }
+    WHEN("I read the range of a measurement description")
+    {
+        msgDesc desc;
+        desc.set_startindex(25);
+        desc.set_endindex(100);
+        THEN("Only the existing records are visited")
+        {
+            CHECK(5 == reader.ReadRange(desc, [](uint64_t, const rocksdb::Slice &) {}));
+        }
+    }
+}
+
+TEST_CASE_METHOD(databaseFixture, "Reading into a caller owned message")
+{
+    std::unique_ptr<google::protobuf::Message> msg(msgCreator.createNewMessage(recorderDesc));
+    {
+        DBCreator creator;
+        creator.create(filepath);
+        creator.createNewColumn("desc");
+        for (uint32_t ctr = 0; ctr < 10; ++ctr)
+        {
+            setRecorderValues(msg.get(), ctr, -static_cast<int32_t>(ctr), 0);
+            creator.writeMsg(ctr, msg.get());
+        }
+    }
+    DBReader reader;
+    reader.Open(filepath);
+    const google::protobuf::FieldDescriptor *voltage = recorderDesc->FindFieldByName("voltage");
+    WHEN("I read an existing record")
+    {
+        reader.ReadMsg(7, msg.get());
+        THEN("The message holds its values")
+        {
+            CHECK(-7 == msg->GetReflection()->GetInt32(*msg, voltage));
+        }
+    }
+    WHEN("I read a non existing record")
+    {
+        THEN("I get an exception")
+        {
+            CHECK_THROWS_AS(reader.ReadMsg(42, msg.get()), std::invalid_argument);
+        }
+    }
+    WHEN("I scan a range into the message")
+    {
+        int32_t sum = 0;
+        reader.ReadRange(0, 10, msg.get(), [&](uint64_t, const google::protobuf::Message &record) {
+            sum += record.GetReflection()->GetInt32(record, voltage);
+        });
+        THEN("Every record was parsed")
+        {
+            CHECK(-45 == sum);
+        }
+    }
+}
+
+TEST_CASE_METHOD(databaseFixture, "Batched point lookups")
+{
+    std::unique_ptr<google::protobuf::Message> msg(msgCreator.createNewMessage(recorderDesc));
+    {
+        DBCreator creator;
+        creator.create(filepath);
+        creator.createNewColumn("desc");
+        for (uint32_t ctr = 0; ctr < 50; ++ctr)
+        {
+            setRecorderValues(msg.get(), ctr, 0, 0);
+            creator.appendMsg(ctr, msg.get());
+        }
+    }
+    DBReader reader;
+    reader.Open(filepath);
+    const google::protobuf::FieldDescriptor *oltc = recorderDesc->FindFieldByName("oltc");
+
+    auto checkResult = [&](const std::vector<uint64_t> &indices) {
+        std::vector<rocksdb::PinnableSlice> values;
+        std::vector<rocksdb::Status> statuses = reader.ReadMany(indices, values);
+        REQUIRE(indices.size() == statuses.size());
+        for (size_t pos = 0; pos < indices.size(); ++pos)
+        {
+            if (indices[pos] < 50)
+            {
+                REQUIRE(statuses[pos].ok());
+                REQUIRE(msg->ParseFromArray(values[pos].data(), static_cast<int>(values[pos].size())));
+                CHECK(indices[pos] == msg->GetReflection()->GetUInt32(*msg, oltc));
+            }
+            else
+            {
+                CHECK(statuses[pos].IsNotFound());
+            }
+        }
+    };
+
+    WHEN("I look up sorted indices")
+    {
+        THEN("Every record is returned at its position")
+        {
+            checkResult({1, 2, 3, 10, 20, 49});
+        }
+    }
+    WHEN("I look up unsorted indices including missing ones")
+    {
+        THEN("Results are returned in request order and missing records don't throw")
+        {
+            checkResult({42, 7, 100, 0, 31, 7, 1000});
+        }
+    }
+}
+
+TEST_CASE_METHOD(databaseFixture, "Compiled schema cache")
+{
+    WHEN("I compile the same schema text twice")
+    {
+        MessageCreator otherCreator;
+        THEN("The descriptor is built only once")
+        {
+            CHECK(recorderDesc == otherCreator.createMessageDesc(recorderText, "recorder_1"));
+        }
+    }
+    WHEN("I store a description with the schema text only")
+    {
+        {
+            DBCreator creator;
+            creator.create(filepath);
+            creator.createNewColumn("desc");
+            msgDesc desc;
+            desc.set_measdescription(recorderText);
+            creator.writeDesc("desc1", desc);
+        }
+        DBReader reader;
+        reader.Open(filepath);
+        msgDesc desc = reader.ReadDesc("desc1");
+        THEN("The compiled FileDescriptorProto is persisted alongside")
+        {
+            REQUIRE_FALSE(desc.measdescriptorproto().empty());
+            google::protobuf::FileDescriptorProto proto;
+            REQUIRE(proto.ParseFromString(desc.measdescriptorproto()));
+            CHECK("recorder_1" == proto.message_type(0).name());
+        }
+        THEN("Reopening reuses the cached descriptor")
+        {
+            MessageCreator otherCreator;
+            CHECK(recorderDesc == otherCreator.createMessageDesc(desc, "recorder_1"));
+        }
+        THEN("A description without text is resolved from the FileDescriptorProto alone")
+        {
+            desc.clear_measdescription();
+            MessageCreator otherCreator;
+            const google::protobuf::Descriptor *descriptor = otherCreator.createMessageDesc(desc, "recorder_1");
+            REQUIRE(descriptor);
+            CHECK(3 == descriptor->field_count());
+        }
+    }
+    WHEN("I compile an invalid schema")
+    {
+        THEN("I get an exception")
+        {
+            CHECK_THROWS_AS(SchemaCache::instance().fromText("message {"), std::invalid_argument);
+        }
+    }
+}
+
+struct recorderRow
+{
+    uint32_t oltc   = 0;
+    int32_t voltage = 0;
+    int32_t current = 0;
+};
+
+TEST_CASE_METHOD(databaseFixture, "Field plans")
+{
+    using RecorderPlan = FieldPlan<uint32_t, int32_t, int32_t>;
+    std::unique_ptr<google::protobuf::Message> msg(msgCreator.createNewMessage(recorderDesc));
+    WHEN("I build a plan matching the schema")
+    {
+        const RecorderPlan plan(recorderDesc, {"oltc", "voltage", "current"});
+        THEN("Filling from a struct sets the fields by slot")
+        {
+            recorderRow row{7, -230, 12};
+            plan.fill(msg.get(), std::tie(row.oltc, row.voltage, row.current));
+            CHECK(7 == msg->GetReflection()->GetUInt32(*msg, recorderDesc->FindFieldByName("oltc")));
+            CHECK(-230 == plan.get<1>(*msg));
+            AND_THEN("Extracting into a struct returns the same values")
+            {
+                recorderRow copy;
+                plan.extract(*msg, std::tie(copy.oltc, copy.voltage, copy.current));
+                CHECK(row.oltc == copy.oltc);
+                CHECK(row.voltage == copy.voltage);
+                CHECK(row.current == copy.current);
+            }
+        }
+        THEN("Single slots can be set and read typed")
+        {
+            plan.set<2>(msg.get(), -5);
+            CHECK(std::make_tuple(0u, 0, -5) == plan.extract(*msg));
+        }
+    }
+    WHEN("I build a plan with a wrong type or an unknown field")
+    {
+        THEN("I get an exception")
+        {
+            CHECK_THROWS_AS(RecorderPlan(recorderDesc, {"oltc", "voltage", "power"}), std::invalid_argument);
+            CHECK_THROWS_AS((FieldPlan<int32_t>(recorderDesc, {"oltc"})), std::invalid_argument);
+        }
+    }
+}
+
+TEST_CASE("Row decoder")
+{
+    constexpr const char *wideText = R"(syntax = "proto3";
+message wide
+{
+    int32 a = 1;
+    sint32 b = 2;
+    uint64 c = 3;
+    double d = 4;
+    float e = 5;
+    sfixed64 f = 6;
+    bool g = 7;
+    fixed32 h = 20;
+})";
+    constexpr const char *mixedText = R"(syntax = "proto3";
+message mixed
+{
+    int32 a = 1;
+    string name = 2;
+    sint64 b = 3;
+    repeated uint32 values = 4;
+})";
+    MessageCreator msgCreator;
+    const google::protobuf::Descriptor *wideDesc = msgCreator.createMessageDesc(wideText, "wide");
+    std::unique_ptr<google::protobuf::Message> msg(msgCreator.createNewMessage(wideDesc));
+    const google::protobuf::Reflection *reflection = msg->GetReflection();
+
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<int32_t> distrib(std::numeric_limits<int32_t>::min(), std::numeric_limits<int32_t>::max());
+    WHEN("I decode records of a flat schema")
+    {
+        RowDecoder decoder(*msg);
+        REQUIRE(decoder.isFlat());
+        REQUIRE(8 == decoder.size());
+        THEN("Every slot matches the value read through Reflection")
+        {
+            for (int ctr = 0; ctr < 100; ++ctr)
+            {
+                reflection->SetInt32(msg.get(), wideDesc->field(0), distrib(gen));
+                reflection->SetInt32(msg.get(), wideDesc->field(1), distrib(gen));
+                reflection->SetUInt64(msg.get(), wideDesc->field(2), static_cast<uint32_t>(distrib(gen)) * 1000ull);
+                reflection->SetDouble(msg.get(), wideDesc->field(3), distrib(gen) / 7.0);
+                reflection->SetFloat(msg.get(), wideDesc->field(4), distrib(gen) / 3.0f);
+                reflection->SetInt64(msg.get(), wideDesc->field(5), -static_cast<int64_t>(ctr) * 12345678901);
+                reflection->SetBool(msg.get(), wideDesc->field(6), ctr % 2);
+                reflection->SetUInt32(msg.get(), wideDesc->field(7), ctr % 3 ? static_cast<uint32_t>(distrib(gen)) : 0u);
+                const std::string wire = msg->SerializeAsString();
+
+                std::array<int64_t, 8> ints;
+                std::array<double, 8> doubles;
+                REQUIRE(decoder.decode(wire.data(), wire.size(), ints.data()));
+                REQUIRE(decoder.decode(wire.data(), wire.size(), doubles.data()));
+                CHECK(reflection->GetInt32(*msg, wideDesc->field(0)) == ints[0]);
+                CHECK(reflection->GetInt32(*msg, wideDesc->field(1)) == ints[1]);
+                CHECK(static_cast<int64_t>(reflection->GetUInt64(*msg, wideDesc->field(2))) == ints[2]);
+                CHECK(reflection->GetDouble(*msg, wideDesc->field(3)) == doubles[3]);
+                CHECK(reflection->GetFloat(*msg, wideDesc->field(4)) == static_cast<float>(doubles[4]));
+                CHECK(reflection->GetInt64(*msg, wideDesc->field(5)) == ints[5]);
+                CHECK(reflection->GetBool(*msg, wideDesc->field(6)) == (1 == ints[6]));
+                CHECK(reflection->GetUInt32(*msg, wideDesc->field(7)) == ints[7]);
+            }
+        }
+        THEN("Truncated records are rejected")
+        {
+            reflection->SetDouble(msg.get(), wideDesc->field(3), 1.5);
+            const std::string wire = msg->SerializeAsString();
+            std::array<double, 8> row;
+            CHECK_FALSE(decoder.decode(wire.data(), wire.size() - 1, row.data()));
+        }
+    }
+    WHEN("I decode a record written with a newer schema")
+    {
+        const google::protobuf::Descriptor *mixedDesc = msgCreator.createMessageDesc(mixedText, "mixed");
+        std::unique_ptr<google::protobuf::Message> mixedMsg(msgCreator.createNewMessage(mixedDesc));
+        const google::protobuf::Reflection *mixedReflection = mixedMsg->GetReflection();
+        mixedReflection->SetInt32(mixedMsg.get(), mixedDesc->FindFieldByName("a"), -17);
+        mixedReflection->SetString(mixedMsg.get(), mixedDesc->FindFieldByName("name"), "transformer");
+        mixedReflection->SetInt64(mixedMsg.get(), mixedDesc->FindFieldByName("b"), -99);
+        mixedReflection->AddUInt32(mixedMsg.get(), mixedDesc->FindFieldByName("values"), 5);
+        const std::string wire = mixedMsg->SerializeAsString();
+
+        THEN("The flat decoder skips the unknown fields")
+        {
+            RowDecoder decoder(*msg);
+            std::array<int64_t, 8> row;
+            REQUIRE(decoder.decode(wire.data(), wire.size(), row.data()));
+            CHECK(-17 == row[0]);
+        }
+        AND_THEN("A non flat schema takes the generic path for its scalar fields")
+        {
+            RowDecoder decoder(*mixedMsg);
+            CHECK_FALSE(decoder.isFlat());
+            REQUIRE(2 == decoder.size());
+            std::array<int64_t, 2> row;
+            REQUIRE(decoder.decode(wire.data(), wire.size(), row.data()));
+            CHECK(-17 == row[decoder.slot("a")]);
+            CHECK(-99 == row[decoder.slot("b")]);
+            CHECK(-1 == decoder.slot("name"));
+        }
+    }
+}
+
+TEST_CASE("Column kernels")
+{
+    const std::vector<int32_t> column{5, -3, 12, 7, 0, -8, 3};
+    CHECK(16 == columnSum(column.data(), column.size()));
+    CHECK(std::make_pair(-8, 12) == columnMinMax(column.data(), column.size()));
+    CHECK(4 == columnCount(column.data(), column.size(), 0, 10));
+
+    std::vector<uint64_t> bins(4);
+    columnHistogram(column.data(), column.size(), -8, 8, bins);
+    CHECK(std::vector<uint64_t>{1, 1, 2, 2} == bins);
+
+    const ColumnStats<int32_t> stats = columnStats(column);
+    CHECK(7 == stats.count);
+    CHECK(Approx(16.0 / 7) == stats.mean());
+
+    const std::vector<double> empty;
+    CHECK(0 == columnStats(empty).count);
+    CHECK(0.0 == columnStats(empty).mean());
+}
+
+TEST_CASE_METHOD(databaseFixture, "Columnar scan")
+{
+    std::unique_ptr<google::protobuf::Message> msg(msgCreator.createNewMessage(recorderDesc));
+    {
+        DBCreator creator;
+        creator.create(filepath);
+        creator.createNewColumn("desc");
+        for (uint32_t ctr = 0; ctr < 100; ++ctr)
+        {
+            setRecorderValues(msg.get(), ctr % 5, 230 + static_cast<int32_t>(ctr), -static_cast<int32_t>(ctr));
+            creator.appendMsg(ctr, msg.get());
+        }
+    }
+    DBReader reader;
+    reader.Open(filepath);
+    RowDecoder decoder(*msg);
+    ColumnBatch<int32_t> batch;
+    WHEN("I scan a range into columns")
+    {
+        CHECK(50 == reader.ReadColumns(10, 60, decoder, batch));
+        THEN("Every field has its own column")
+        {
+            REQUIRE(3 == batch.columns.size());
+            REQUIRE(50 == batch.size());
+            CHECK(10 == batch.indices.front());
+            const ColumnStats<int32_t> voltage = columnStats(batch.columns[decoder.slot("voltage")]);
+            CHECK(240 == voltage.min);
+            CHECK(289 == voltage.max);
+            CHECK(Approx(264.5) == voltage.mean());
+            const ColumnStats<int32_t> current = columnStats(batch.columns[decoder.slot("current")]);
+            CHECK(-59 == current.min);
+            CHECK(-10 == current.max);
+        }
+        AND_WHEN("I scan the next range into the same batch")
+        {
+            CHECK(40 == reader.ReadColumns(60, 200, decoder, batch));
+            THEN("The columns are appended")
+            {
+                CHECK(90 == batch.size());
+                CHECK(90 == batch.columns[0].size());
+            }
+        }
+    }
+}
+
+TEST_CASE_METHOD(databaseFixture, "Time range queries")
+{
+    std::unique_ptr<google::protobuf::Message> msg(msgCreator.createNewMessage(recorderDesc));
+    {
+        DBCreator creator;
+        creator.create(filepath);
+        creator.createNewColumn("desc");
+        creator.createTimeIndexColumn();
+        // one sample per 10 ms, starting at 10:00:00
+        constexpr uint64_t start = 36000000;
+        for (uint32_t ctr = 0; ctr < 100; ++ctr)
+        {
+            setRecorderValues(msg.get(), ctr, 0, 0);
+            creator.appendMsg(ctr, start + 10 * ctr, msg.get());
+        }
+        // a late sample with an older timestamp
+        setRecorderValues(msg.get(), 100, 0, 0);
+        creator.writeMsg(100, start + 205, msg.get());
+        // a record without index entry
+        creator.writeMsg(101, msg.get());
+    }
+    DBReader reader;
+    reader.Open(filepath);
+    WHEN("I query a time range")
+    {
+        std::vector<uint64_t> indices;
+        std::vector<uint64_t> timestamps;
+        const size_t numRead = reader.ReadTimeRange(36000200, 36000250, [&](uint64_t index, uint64_t timestamp, const rocksdb::Slice &value) {
+            REQUIRE(msg->ParseFromArray(value.data(), static_cast<int>(value.size())));
+            CHECK(index == msg->GetReflection()->GetUInt32(*msg, recorderDesc->FindFieldByName("oltc")));
+            indices.push_back(index);
+            timestamps.push_back(timestamp);
+        });
+        THEN("I get the matching records ordered by time")
+        {
+            CHECK(6 == numRead);
+            CHECK(std::vector<uint64_t>{20, 100, 21, 22, 23, 24} == indices);
+            CHECK(std::is_sorted(timestamps.begin(), timestamps.end()));
+        }
+    }
+    WHEN("I query a range without samples")
+    {
+        THEN("Nothing is visited")
+        {
+            CHECK(0 == reader.ReadTimeRange(0, 36000000, [](uint64_t, uint64_t, const rocksdb::Slice &) {}));
+        }
+    }
+}
+
+TEST_CASE_METHOD(databaseFixture, "Time range queries without time index")
+{
+    std::unique_ptr<google::protobuf::Message> msg(msgCreator.createNewMessage(recorderDesc));
+    {
+        DBCreator creator;
+        creator.create(filepath);
+        creator.createNewColumn("desc");
+        WHEN("I write a record with timestamp")
+        {
+            THEN("I get an exception")
+            {
+                CHECK_THROWS_AS(creator.writeMsg(0, 10, msg.get()), std::invalid_argument);
+                CHECK_THROWS_AS(creator.appendMsg(0, 10, msg.get()), std::invalid_argument);
+                CHECK(0 == creator.pendingMsgs());
+            }
+        }
+    }
+    WHEN("I query a time range")
+    {
+        DBReader reader;
+        reader.Open(filepath);
+        THEN("I get an exception")
+        {
+            CHECK_THROWS_AS(reader.ReadTimeRange(0, 10, [](uint64_t, uint64_t, const rocksdb::Slice &) {}), std::invalid_argument);
+        }
+    }
+}
+
+TEST_CASE_METHOD(databaseFixture, "Chunked records")
+{
+    std::unique_ptr<google::protobuf::Message> msg(msgCreator.createNewMessage(recorderDesc));
+    const google::protobuf::FieldDescriptor *oltc = recorderDesc->FindFieldByName("oltc");
+    {
+        DBCreator creator;
+        creator.create(filepath);
+        creator.createNewColumn("desc");
+        creator.createChunkedColumn("chunks", 16);
+        for (uint32_t ctr = 0; ctr < 100; ++ctr)
+        {
+            // leave a gap in the second chunk
+            if (ctr < 20 || ctr > 25)
+            {
+                setRecorderValues(msg.get(), ctr, 0, 0);
+                creator.appendChunkedMsg("chunks", ctr, msg.get());
+            }
+            if (50 == ctr)
+            {
+                // writes the partially filled chunk, which is completed by the following records
+                creator.flush();
+            }
+        }
+        WHEN("I append an index in front of the open chunk")
+        {
+            THEN("I get an exception")
+            {
+                CHECK_THROWS_AS(creator.appendChunkedMsg("chunks", 10, msg.get()), std::invalid_argument);
+                CHECK_THROWS_AS(creator.appendChunkedMsg("unknown", 100, msg.get()), std::invalid_argument);
+            }
+        }
+    }
+    DBReader reader;
+    reader.Open(filepath);
+    WHEN("I read single records")
+    {
+        THEN("Every record is found in its chunk")
+        {
+            for (uint32_t ctr : {0u, 15u, 16u, 19u, 26u, 48u, 51u, 63u, 64u, 99u})
+            {
+                reader.ReadChunkedMsg("chunks", ctr, msg.get());
+                CHECK(ctr == msg->GetReflection()->GetUInt32(*msg, oltc));
+            }
+        }
+        AND_THEN("Missing records are reported")
+        {
+            CHECK_THROWS_AS(reader.ReadChunkedMsg("chunks", 22, msg.get()), std::invalid_argument);
+            CHECK_THROWS_AS(reader.ReadChunkedMsg("chunks", 100, msg.get()), std::invalid_argument);
+        }
+    }
+    WHEN("I read a range crossing chunk boundaries")
+    {
+        std::vector<uint64_t> indices;
+        const size_t numRead = reader.ReadChunkedRange("chunks", 18, 70, [&](uint64_t index, const rocksdb::Slice &value) {
+            REQUIRE(msg->ParseFromArray(value.data(), static_cast<int>(value.size())));
+            CHECK(index == msg->GetReflection()->GetUInt32(*msg, oltc));
+            indices.push_back(index);
+        });
+        THEN("I get the records of the range in ascending order")
+        {
+            CHECK(46 == numRead);
+            CHECK(18 == indices.front());
+            CHECK(69 == indices.back());
+            CHECK(std::is_sorted(indices.begin(), indices.end()));
+            CHECK(indices.end() == std::find(indices.begin(), indices.end(), 22));
+        }
+    }
+    WHEN("I read the whole column")
+    {
+        THEN("Every record is visited once")
+        {
+            CHECK(94 == reader.ReadChunkedRange("chunks", 0, 1000, [](uint64_t, const rocksdb::Slice &) {}));
+            CHECK(0 == reader.ReadChunkedRange("chunks", 100, 1000, [](uint64_t, const rocksdb::Slice &) {}));
+        }
+    }
+}
+
+TEST_CASE("Column chunk codec")
+{
+    constexpr const char *sampleText = R"(syntax = "proto3";
+message sample
+{
+    uint64 timestamp = 1;
+    int32 voltage = 2;
+    sint32 delta = 3;
+    float current = 5;
+    double power = 4;
+    fixed64 counter = 6;
+    sfixed32 offset = 7;
+    bool alarm = 8;
+    int64 energy = 9;
+})";
+    MessageCreator creator;
+    const google::protobuf::Descriptor *desc = creator.createMessageDesc(sampleText, "sample");
+    REQUIRE(desc);
+    std::unique_ptr<google::protobuf::Message> msg(creator.createNewMessage(desc));
+    const google::protobuf::Reflection *reflection = msg->GetReflection();
+
+    std::mt19937 gen(42);
+    std::uniform_int_distribution<int32_t> noise(-3, 3);
+    std::vector<std::string> records;
+    ChunkBuilder builder;
+    builder.reset(1000);
+    builder.useColumns(desc);
+    for (uint32_t ctr = 0; ctr < 300; ++ctr)
+    {
+        reflection->SetUInt64(msg.get(), desc->FindFieldByName("timestamp"), 1600000000000 + 10 * ctr + (ctr % 7 == 0 ? 1 : 0));
+        reflection->SetInt32(msg.get(), desc->FindFieldByName("voltage"), ctr % 50 == 0 ? INT32_MIN : 23000 + noise(gen));
+        reflection->SetInt32(msg.get(), desc->FindFieldByName("delta"), ctr % 3 == 0 ? 0 : noise(gen));
+        reflection->SetFloat(msg.get(), desc->FindFieldByName("current"), ctr % 40 == 0 ? -0.0f : 12.5f + 0.25f * static_cast<float>(noise(gen)));
+        reflection->SetDouble(msg.get(), desc->FindFieldByName("power"), 1000.0 + ctr / 100);
+        reflection->SetUInt64(msg.get(), desc->FindFieldByName("counter"), ctr == 150 ? UINT64_MAX : ctr);
+        reflection->SetInt32(msg.get(), desc->FindFieldByName("offset"), -static_cast<int32_t>(ctr % 5));
+        reflection->SetBool(msg.get(), desc->FindFieldByName("alarm"), ctr % 100 == 99);
+        reflection->SetInt64(msg.get(), desc->FindFieldByName("energy"), INT64_MIN + ctr * ctr);
+        records.emplace_back();
+        msg->SerializeToString(&records.back());
+        // leave gaps in the indices
+        builder.add(1000 + 2 * ctr, records.back());
+    }
+
+    WHEN("I encode a chunk as columns")
+    {
+        const std::string value = builder.finish();
+        size_t recordBytes      = 0;
+        for (const std::string &record : records)
+        {
+            recordBytes += record.size();
+        }
+        THEN("The chunk is column coded and smaller than the records")
+        {
+            CHECK(static_cast<char>(ChunkEncoding::Columns) == value[0]);
+            CHECK(value.size() * 2 < recordBytes);
+        }
+        AND_THEN("The records are rebuilt byte identical")
+        {
+            ChunkView view;
+            REQUIRE(view.parse(value));
+            REQUIRE(records.size() == view.size());
+            for (size_t pos = 0; pos < view.size(); ++pos)
+            {
+                CHECK(2 * pos == view.offset(pos));
+                CHECK(records[pos] == view.record(pos).ToString());
+            }
+        }
+        AND_THEN("A truncated chunk is rejected")
+        {
+            ChunkView view;
+            CHECK_FALSE(view.parse(rocksdb::Slice(value.data(), value.size() - 1)));
+        }
+    }
+    WHEN("A record can't be column coded")
+    {
+        // field 10 is not part of the schema
+        builder.add(2000, records.front() + std::string("\x50\x01", 2));
+        const std::string value = builder.finish();
+        THEN("The chunk falls back to the records format")
+        {
+            CHECK(static_cast<char>(ChunkEncoding::Records) == value[0]);
+            ChunkView view;
+            REQUIRE(view.parse(value));
+            CHECK(records.size() + 1 == view.size());
+            CHECK(records.back() == view.record(records.size() - 1).ToString());
+        }
+    }
+    WHEN("I use the codec for a schema with strings")
+    {
+        THEN("It is not supported")
+        {
+            CHECK_FALSE(ColumnChunkCodec(msgDesc::descriptor()).supported());
+            CHECK(ColumnChunkCodec(desc).supported());
+        }
+    }
+    WHEN("I use the codec for a schema with huge field numbers")
+    {
+        constexpr const char *sparseText = R"(syntax = "proto3";
+message sparse
+{
+    uint32 value = 536870911;
+}
+)";
+        MessageCreator sparseCreator;
+        const google::protobuf::Descriptor *sparse = sparseCreator.createMessageDesc(sparseText, "sparse");
+        THEN("It is not supported instead of allocating a table of all numbers")
+        {
+            REQUIRE(sparse);
+            CHECK_FALSE(ColumnChunkCodec(sparse).supported());
+        }
+    }
+}
+
+TEST_CASE_METHOD(databaseFixture, "Column coded chunked records")
+{
+    std::unique_ptr<google::protobuf::Message> msg(msgCreator.createNewMessage(recorderDesc));
+    {
+        DBCreator creator;
+        creator.create(filepath);
+        creator.createNewColumn("desc");
+        creator.createChunkedColumn("columns", 64, ChunkEncoding::Columns);
+        for (uint32_t ctr = 0; ctr < 200; ++ctr)
+        {
+            setRecorderValues(msg.get(), ctr / 10, 23000 + static_cast<int32_t>(ctr % 7), -static_cast<int32_t>(ctr));
+            creator.appendChunkedMsg("columns", ctr, msg.get());
+        }
+        WHEN("I append a record of another schema")
+        {
+            msgDesc desc;
+            THEN("I get an exception")
+            {
+                CHECK_THROWS_AS(creator.appendChunkedMsg("columns", 200, &desc), std::invalid_argument);
+            }
+        }
+        WHEN("I append a record of the same schema compiled again")
+        {
+            // the same FileDescriptorProto built into another pool
+            google::protobuf::FileDescriptorProto proto;
+            recorderDesc->file()->CopyTo(&proto);
+            const CompiledSchema compiled(proto);
+            const google::protobuf::Descriptor *otherDesc = compiled.findMessageType("recorder_1");
+            REQUIRE(otherDesc != recorderDesc);
+            std::unique_ptr<google::protobuf::Message> other(compiled.prototype(otherDesc)->New());
+            REQUIRE(other->ParseFromString(msg->SerializeAsString()));
+            THEN("It is accepted")
+            {
+                CHECK_NOTHROW(creator.appendChunkedMsg("columns", 200, other.get()));
+            }
+        }
+    }
+    DBReader reader;
+    reader.Open(filepath);
+    WHEN("I read the records back")
+    {
+        std::vector<int32_t> currents;
+        const size_t numRead = reader.ReadChunkedRange("columns", 0, 200, [&](uint64_t index, const rocksdb::Slice &value) {
+            REQUIRE(msg->ParseFromArray(value.data(), static_cast<int>(value.size())));
+            CHECK(index / 10 == msg->GetReflection()->GetUInt32(*msg, recorderDesc->FindFieldByName("oltc")));
+            currents.push_back(msg->GetReflection()->GetInt32(*msg, recorderDesc->FindFieldByName("current")));
+        });
+        THEN("I get the values written")
+        {
+            CHECK(200 == numRead);
+            CHECK(-199 == currents.back());
+            reader.ReadChunkedMsg("columns", 130, msg.get());
+            CHECK(23000 + 130 % 7 == msg->GetReflection()->GetInt32(*msg, recorderDesc->FindFieldByName("voltage")));
+        }
+    }
+}
+
+TEST_CASE("Bounded queue")
+{
+    BoundedQueue<int> queue(3);
+    CHECK(4 == queue.capacity());
+    WHEN("I push more values than the capacity")
+    {
+        for (int ctr = 0; ctr < 4; ++ctr)
+        {
+            CHECK(queue.tryPush(int(ctr)));
+        }
+        THEN("The push is refused")
+        {
+            CHECK_FALSE(queue.tryPush(4));
+            CHECK(4 == queue.size());
+        }
+        AND_THEN("The values are popped in order")
+        {
+            int value = -1;
+            for (int ctr = 0; ctr < 4; ++ctr)
+            {
+                REQUIRE(queue.tryPop(value));
+                CHECK(ctr == value);
+            }
+            CHECK_FALSE(queue.tryPop(value));
+            CHECK(4 == queue.dequeued());
+        }
+    }
+}
+
+TEST_CASE_METHOD(databaseFixture, "Ingest pipeline")
+{
+    constexpr uint32_t numProducers = 4;
+    constexpr uint32_t perProducer  = 2000;
+    IngestStats stats;
+    {
+        DBCreator creator;
+        creator.create(filepath);
+        creator.createNewColumn("desc");
+        IngestOptions options;
+        // small queue and batches, so the producers run into the backpressure
+        options.queueCapacity = 64;
+        options.maxBatchCount = 100;
+        options.writerThreads = 2;
+        creator.metrics().setEnabled(true);
+        // a pending record of the creator is committed before the pipeline starts
+        std::unique_ptr<google::protobuf::Message> pending(msgCreator.createNewMessage(recorderDesc));
+        setRecorderValues(pending.get(), numProducers * perProducer, 0, 0);
+        creator.appendMsg(numProducers * perProducer, pending.get());
+        IngestPipeline pipeline(creator, options);
+        CHECK(0 == creator.pendingMsgs());
+
+        std::vector<std::thread> producers;
+        for (uint32_t producer = 0; producer < numProducers; ++producer)
+        {
+            producers.emplace_back([&, producer]() {
+                std::unique_ptr<google::protobuf::Message> msg(msgCreator.createNewMessage(recorderDesc));
+                for (uint32_t ctr = 0; ctr < perProducer; ++ctr)
+                {
+                    const uint32_t index = producer * perProducer + ctr;
+                    setRecorderValues(msg.get(), index, 0, 0);
+                    pipeline.push(index, msg.get());
+                }
+            });
+        }
+        for (auto &producer : producers)
+        {
+            producer.join();
+        }
+        pipeline.flush();
+        stats = pipeline.stats();
+        WHEN("I flush the pipeline")
+        {
+            THEN("Everything pushed is committed")
+            {
+                CHECK(numProducers * perProducer == stats.pushed);
+                CHECK(stats.pushed == stats.committed);
+                CHECK(0 == stats.failed);
+                CHECK(0 == stats.queueDepth);
+                CHECK(stats.maxQueueDepth <= 64);
+                CHECK(0 < stats.batches);
+                CHECK(stats.maxLatency >= stats.meanLatency);
+                // the pipeline commits through the creator
+                CHECK(stats.batches + 1 == creator.metrics().snapshot().latency(DBOperation::Put).count);
+            }
+        }
+    }
+    WHEN("I read the records")
+    {
+        DBReader reader;
+        reader.Open(filepath);
+        std::unique_ptr<google::protobuf::Message> msg(msgCreator.createNewMessage(recorderDesc));
+        uint64_t expected = 0;
+        const size_t numRead = reader.ReadRange(0, numProducers * perProducer, msg.get(), [&](uint64_t index, const google::protobuf::Message &record) {
+            CHECK(expected++ == index);
+            CHECK(index == record.GetReflection()->GetUInt32(record, recorderDesc->FindFieldByName("oltc")));
+        });
+        THEN("Every record of every producer is stored")
+        {
+            CHECK(numProducers * perProducer == numRead);
+        }
+    }
+}
+
+TEST_CASE("Index range split")
+{
+    WHEN("I split a range")
+    {
+        const auto ranges = splitIndexRange(10, 31, 4);
+        THEN("The sub ranges adjoin and cover the range")
+        {
+            REQUIRE(4 == ranges.size());
+            CHECK(10 == ranges.front().first);
+            CHECK(31 == ranges.back().second);
+            for (size_t pos = 1; pos < ranges.size(); ++pos)
+            {
+                CHECK(ranges[pos - 1].second == ranges[pos].first);
+                CHECK(5 <= ranges[pos].second - ranges[pos].first);
+                CHECK(6 >= ranges[pos].second - ranges[pos].first);
+            }
+        }
+    }
+    WHEN("I split a range into more parts than indices")
+    {
+        THEN("Every part gets one index")
+        {
+            CHECK(3 == splitIndexRange(0, 3, 8).size());
+            CHECK(splitIndexRange(5, 5, 8).empty());
+        }
+    }
+}
+
+TEST_CASE_METHOD(databaseFixture, "Parallel range scans")
+{
+    std::unique_ptr<google::protobuf::Message> msg(msgCreator.createNewMessage(recorderDesc));
+    {
+        DBCreator creator;
+        creator.create(filepath);
+        creator.createNewColumn("desc");
+        for (uint32_t ctr = 0; ctr < 1000; ++ctr)
+        {
+            // leave some holes
+            if (ctr % 13)
+            {
+                setRecorderValues(msg.get(), ctr, static_cast<int32_t>(ctr % 17), 0);
+                creator.appendMsg(ctr, msg.get());
+            }
+        }
+    }
+    DBReader reader;
+    reader.Open(filepath);
+    WorkerPool pool(4);
+
+    WHEN("I collect the indices of the sub ranges")
+    {
+        const auto partials = reader.ReadRangeParallel(
+            100, 900, pool, 7, []() { return std::vector<uint64_t>(); },
+            [](std::vector<uint64_t> &indices, uint64_t index, const rocksdb::Slice &) { indices.push_back(index); });
+        THEN("Merging the partials in order gives the sequential scan")
+        {
+            std::vector<uint64_t> merged;
+            for (const auto &partial : partials)
+            {
+                merged.insert(merged.end(), partial.begin(), partial.end());
+            }
+            std::vector<uint64_t> expected;
+            reader.ReadRange(100, 900, [&](uint64_t index, const rocksdb::Slice &) { expected.push_back(index); });
+            CHECK(7 == partials.size());
+            CHECK(expected == merged);
+        }
+    }
+    WHEN("I reduce partial sums unordered")
+    {
+        const google::protobuf::FieldDescriptor *voltage = recorderDesc->FindFieldByName("voltage");
+        struct Partial
+        {
+            std::unique_ptr<google::protobuf::Message> msg;
+            int64_t sum = 0;
+        };
+        int64_t total        = 0;
+        size_t reduced       = 0;
+        const size_t numRead = reader.ReadRangeParallel(
+            0, 1000, pool, 16, [&]() { return Partial{std::unique_ptr<google::protobuf::Message>(msg->New()), 0}; },
+            [voltage](Partial &partial, uint64_t, const rocksdb::Slice &value) {
+                partial.msg->ParseFromArray(value.data(), static_cast<int>(value.size()));
+                partial.sum += partial.msg->GetReflection()->GetInt32(*partial.msg, voltage);
+            },
+            [&](Partial &&partial) {
+                total += partial.sum;
+                ++reduced;
+            });
+        THEN("I get the sequential result")
+        {
+            int64_t expected = 0;
+            for (uint32_t ctr = 0; ctr < 1000; ++ctr)
+            {
+                expected += ctr % 13 ? ctr % 17 : 0;
+            }
+            CHECK(1000 - 77 == numRead);
+            CHECK(16 == reduced);
+            CHECK(expected == total);
+        }
+    }
+    WHEN("I scan columns in parallel")
+    {
+        ColumnBatch<int64_t> batch;
+        const size_t numRead = reader.ReadColumnsParallel(0, 1000, pool, 5, *msg, batch);
+        THEN("The batch matches the sequential scan")
+        {
+            ColumnBatch<int64_t> expected;
+            RowDecoder decoder(*msg);
+            reader.ReadColumns(0, 1000, decoder, expected);
+            CHECK(expected.size() == numRead);
+            CHECK(expected.indices == batch.indices);
+            CHECK(expected.columns == batch.columns);
+        }
+    }
+    WHEN("A sub range fails")
+    {
+        THEN("The exception reaches the caller")
+        {
+            CHECK_THROWS_AS(reader.ReadRangeParallel(
+                                0, 1000, pool, 4, []() { return 0; },
+                                [](int &, uint64_t index, const rocksdb::Slice &) {
+                                    if (500 == index)
+                                    {
+                                        throw std::invalid_argument("Error while parsing");
+                                    }
+                                }),
+                            std::invalid_argument);
+        }
+    }
+}
+
+TEST_CASE_METHOD(databaseFixture, "Bulk import")
+{
+    std::unique_ptr<google::protobuf::Message> msg(msgCreator.createNewMessage(recorderDesc));
+    const google::protobuf::FieldDescriptor *oltc = recorderDesc->FindFieldByName("oltc");
+    {
+        DBCreator creator;
+        creator.create(filepath);
+        creator.createNewColumn("desc");
+        // an older version of a record, replaced by the import
+        setRecorderValues(msg.get(), 0, 0, 0);
+        creator.writeMsg(10, msg.get());
+
+        BulkImportOptions options;
+        options.targetFileSize = 4 * 1024;
+        BulkImporter importer(creator, options);
+        // backwards, so the importer has to sort
+        for (uint32_t ctr = 5000; ctr > 0; --ctr)
+        {
+            setRecorderValues(msg.get(), ctr - 1, 0, 0);
+            importer.addMsg(ctr - 1, msg.get());
+        }
+        // a second record for the same index wins
+        setRecorderValues(msg.get(), 4242, 1, 0);
+        importer.addMsg(42, msg.get());
+        msgDesc desc;
+        desc.set_measdescription(recorderText);
+        desc.set_startindex(0);
+        desc.set_endindex(5000);
+        importer.addDesc("recorder_1", desc);
+        CHECK(5001 == importer.pendingMsgs());
+        importer.finish();
+        // the staging files are gone
+        CHECK(0 == importer.pendingMsgs());
+        CHECK_FALSE(std::filesystem::exists(filepath + ".import"));
+
+        // a caller supplied directory and its other content are kept
+        options.stagingDir = filepath + ".staging";
+        std::filesystem::create_directories(options.stagingDir / "keep");
+        BulkImporter staged(creator, options);
+        setRecorderValues(msg.get(), 4343, 1, 0);
+        staged.addMsg(43, msg.get());
+        staged.finish();
+        CHECK(std::filesystem::exists(options.stagingDir / "keep"));
+        CHECK(1 == std::distance(std::filesystem::directory_iterator(options.stagingDir), std::filesystem::directory_iterator()));
+        std::filesystem::remove_all(options.stagingDir);
+    }
+    DBReader reader;
+    reader.Open(filepath);
+    WHEN("I read the imported data")
+    {
+        const msgDesc desc = reader.ReadDesc("recorder_1");
+        THEN("Records and description are stored")
+        {
+            CHECK(5000 == desc.endindex());
+            CHECK_FALSE(desc.measdescriptorproto().empty());
+            uint64_t expected = 0;
+            const size_t numRead = reader.ReadRange(desc, [&](uint64_t index, const rocksdb::Slice &value) {
+                REQUIRE(msg->ParseFromArray(value.data(), static_cast<int>(value.size())));
+                CHECK(expected++ == index);
+                CHECK((42 == index ? 4242 : 43 == index ? 4343 : index) == msg->GetReflection()->GetUInt32(*msg, oltc));
+            });
+            CHECK(5000 == numRead);
+        }
+    }
+}
+
+TEST_CASE_METHOD(databaseFixture, "Operation metrics")
+{
+    std::unique_ptr<google::protobuf::Message> msg(msgCreator.createNewMessage(recorderDesc));
+    {
+        DBCreator creator;
+        creator.metrics().enableStatistics();
+        creator.create(filepath);
+        // not enabled yet, nothing is timed
+        setRecorderValues(msg.get(), 0, 0, 0);
+        creator.writeMsg(0, msg.get());
+        CHECK(0 == creator.metrics().snapshot().latency(DBOperation::Put).count);
+
+        creator.metrics().setEnabled(true);
+        for (uint32_t ctr = 1; ctr < 100; ++ctr)
+        {
+            setRecorderValues(msg.get(), ctr, 0, 0);
+            creator.writeMsg(ctr, msg.get());
+        }
+        const MetricsSnapshot snapshot = creator.metrics().snapshot();
+        CHECK(99 == snapshot.latency(DBOperation::Serialize).count);
+        CHECK(99 == snapshot.latency(DBOperation::Put).count);
+        CHECK(0 == snapshot.latency(DBOperation::Get).count);
+        CHECK_FALSE(snapshot.tickers.empty());
+    }
+    DBReader reader;
+    reader.metrics().setEnabled(true);
+    reader.Open(filepath);
+    WHEN("I read the records")
+    {
+        DBMetrics::capturePerfContext(true);
+        for (uint32_t ctr = 0; ctr < 100; ++ctr)
+        {
+            reader.ReadMsg(ctr, msg.get());
+        }
+        const MetricsSnapshot snapshot = reader.metrics().snapshot();
+        DBMetrics::capturePerfContext(false);
+        THEN("Gets and parses are timed")
+        {
+            const LatencySummary &get = snapshot.latency(DBOperation::Get);
+            CHECK(100 == get.count);
+            CHECK(get.minNanos <= get.p50Nanos);
+            CHECK(get.p50Nanos <= get.p99Nanos);
+            CHECK(get.p99Nanos <= get.maxNanos);
+            CHECK(100 == snapshot.latency(DBOperation::Parse).count);
+            CHECK(snapshot.tickers.empty());
+            CHECK(snapshot.perfCaptured);
+        }
+        THEN("The snapshot is dumped as JSON")
+        {
+            const std::string json = snapshot.toJson();
+            CHECK(json.find("\"get\":{\"count\":100,") != std::string::npos);
+            CHECK(json.find("\"perf\":{") != std::string::npos);
+        }
+        AND_WHEN("I reset the metrics")
+        {
+            reader.metrics().reset();
+            THEN("The histograms are empty")
+            {
+                CHECK(0 == reader.metrics().snapshot().latency(DBOperation::Get).count);
+                CHECK_FALSE(reader.metrics().snapshot().perfCaptured);
+            }
+        }
+    }
+}
+
+TEST_CASE_METHOD(databaseFixture, "Arena batch decoding")
+{
+    constexpr const char *eventText = R"(syntax = "proto3";
+message event
+{
+    string source = 1;
+    repeated int32 samples = 2;
+})";
+    const google::protobuf::Descriptor *eventDesc = msgCreator.createMessageDesc(eventText, "event");
+    REQUIRE(eventDesc);
+    const google::protobuf::FieldDescriptor *source  = eventDesc->FindFieldByName("source");
+    const google::protobuf::FieldDescriptor *samples = eventDesc->FindFieldByName("samples");
+    {
+        std::unique_ptr<google::protobuf::Message> msg(msgCreator.createNewMessage(eventDesc));
+        DBCreator creator;
+        creator.create(filepath);
+        for (uint32_t ctr = 0; ctr < 250; ++ctr)
+        {
+            msg->Clear();
+            msg->GetReflection()->SetString(msg.get(), source, "sensor " + std::to_string(ctr));
+            for (uint32_t sample = 0; sample < ctr % 5; ++sample)
+            {
+                msg->GetReflection()->AddInt32(msg.get(), samples, static_cast<int32_t>(ctr + sample));
+            }
+            creator.appendMsg(ctr, msg.get());
+        }
+    }
+    DBReader reader;
+    reader.Open(filepath);
+    ArenaBatch batch(msgCreator.prototype(eventDesc), 64 * 1024);
+    auto checkBatch = [&](const ArenaBatch &decoded) {
+        for (size_t pos = 0; pos < decoded.size(); ++pos)
+        {
+            const uint64_t index                 = decoded.index(pos);
+            const google::protobuf::Message &msg = decoded.message(pos);
+            CHECK(msg.GetArena());
+            CHECK("sensor " + std::to_string(index) == msg.GetReflection()->GetString(msg, source));
+            REQUIRE(static_cast<int>(index % 5) == msg.GetReflection()->FieldSize(msg, samples));
+            for (int sample = 0; sample < msg.GetReflection()->FieldSize(msg, samples); ++sample)
+            {
+                CHECK(static_cast<int32_t>(index + sample) == msg.GetReflection()->GetRepeatedInt32(msg, samples, sample));
+            }
+        }
+    };
+    WHEN("I decode a range into one batch")
+    {
+        const size_t numRead = reader.ReadBatch(10, 110, batch);
+        THEN("Every record has its message on the arena")
+        {
+            CHECK(100 == numRead);
+            REQUIRE(100 == batch.size());
+            CHECK(10 == batch.index(0));
+            CHECK(109 == batch.index(99));
+            checkBatch(batch);
+        }
+        AND_WHEN("I decode the next range")
+        {
+            reader.ReadBatch(110, 120, batch);
+            THEN("The batch only holds the new records")
+            {
+                REQUIRE(10 == batch.size());
+                CHECK(110 == batch.index(0));
+                checkBatch(batch);
+            }
+        }
+    }
+    WHEN("I decode a range in batches")
+    {
+        std::vector<size_t> sizes;
+        const size_t numRead = reader.ReadBatches(0, 250, batch, 100, [&](const ArenaBatch &decoded) {
+            checkBatch(decoded);
+            sizes.push_back(decoded.size());
+        });
+        THEN("The callback gets full batches and the rest")
+        {
+            CHECK(250 == numRead);
+            CHECK(std::vector<size_t>{100, 100, 50} == sizes);
+            CHECK(batch.empty());
+        }
+    }
+    WHEN("I create a single message on an arena")
+    {
+        google::protobuf::Arena arena;
+        google::protobuf::Message *msg = msgCreator.createNewMessage(eventDesc, &arena);
+        THEN("The arena owns it")
+        {
+            CHECK(&arena == msg->GetArena());
+        }
+    }
+}
+
+TEST_CASE_METHOD(databaseFixture, "Live tailing")
+{
+    std::unique_ptr<google::protobuf::Message> msg(msgCreator.createNewMessage(recorderDesc));
+    const google::protobuf::FieldDescriptor *oltc = recorderDesc->FindFieldByName("oltc");
+    DBCreator creator;
+    creator.create(filepath);
+    // the secondary follows the WAL
+    BatchOptions batchOptions;
+    batchOptions.disableWAL = false;
+    creator.setBatchOptions(batchOptions);
+    auto write = [&](uint32_t begin, uint32_t end) {
+        for (uint32_t ctr = begin; ctr < end; ++ctr)
+        {
+            setRecorderValues(msg.get(), ctr, 0, 0);
+            creator.writeMsg(ctr, msg.get());
+        }
+    };
+    write(0, 10);
+    DBReader reader;
+    reader.OpenAsSecondary(filepath);
+    std::unique_ptr<google::protobuf::Message> record(msgCreator.createNewMessage(recorderDesc));
+    WHEN("I poll a subscription while the writer goes on")
+    {
+        TailOptions options;
+        options.pollInterval = std::chrono::milliseconds(0);
+        LiveTail tail(reader, options);
+        std::vector<uint64_t> seen;
+        const uint64_t id = tail.subscribe(5, [&](uint64_t index, const rocksdb::Slice &value) {
+            REQUIRE(record->ParseFromArray(value.data(), static_cast<int>(value.size())));
+            CHECK(index == record->GetReflection()->GetUInt32(*record, oltc));
+            seen.push_back(index);
+        });
+        CHECK(5 == tail.poll());
+        write(10, 20);
+        CHECK(10 == tail.poll());
+        CHECK(0 == tail.poll());
+        THEN("Every record is delivered once, by ascending index")
+        {
+            std::vector<uint64_t> expected(15);
+            std::iota(expected.begin(), expected.end(), 5);
+            CHECK(expected == seen);
+        }
+        AND_WHEN("I unsubscribe")
+        {
+            tail.unsubscribe(id);
+            write(20, 30);
+            THEN("Nothing is delivered anymore")
+            {
+                CHECK(0 == tail.poll());
+                CHECK(15 == seen.size());
+            }
+        }
+    }
+    WHEN("The poll thread follows the writer")
+    {
+        TailOptions options;
+        options.pollInterval = std::chrono::milliseconds(5);
+        LiveTail tail(reader, options);
+        std::atomic<uint64_t> delivered{0};
+        std::atomic<uint64_t> last{0};
+        tail.subscribe(0, [&](uint64_t index, const rocksdb::Slice &) {
+            last = index;
+            ++delivered;
+        });
+        write(10, 100);
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (delivered < 100 && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        THEN("The new records arrive without polling")
+        {
+            CHECK(100 == delivered);
+            CHECK(99 == last);
+            CHECK_FALSE(tail.error());
+        }
+    }
+}
+
+TEST_CASE_METHOD(databaseFixture, "Record cache")
+{
+    std::unique_ptr<google::protobuf::Message> msg(msgCreator.createNewMessage(recorderDesc));
+    const google::protobuf::FieldDescriptor *oltc = recorderDesc->FindFieldByName("oltc");
+    auto cache                                    = std::make_shared<RecordCache>(1024 * 1024, 4);
+    DBCreator creator;
+    creator.create(filepath);
+    creator.setRecordCache(cache);
+    // the secondary follows the WAL while the creator keeps writing
+    BatchOptions batchOptions;
+    batchOptions.disableWAL = false;
+    creator.setBatchOptions(batchOptions);
+    for (uint32_t ctr = 0; ctr < 10; ++ctr)
+    {
+        setRecorderValues(msg.get(), ctr, 0, 0);
+        creator.writeMsg(ctr, msg.get());
+    }
+    DBReader reader;
+    reader.OpenAsSecondary(filepath);
+    reader.setRecordCache(cache);
+    const google::protobuf::Message &prototype = msgCreator.prototype(recorderDesc);
+    auto oltcOf = [oltc](const std::shared_ptr<const google::protobuf::Message> &record) { return record->GetReflection()->GetUInt32(*record, oltc); };
+
+    WHEN("I read a record twice")
+    {
+        const auto first  = reader.ReadCachedMsg(3, prototype);
+        const auto second = reader.ReadCachedMsg(3, prototype);
+        THEN("The second read is served by the cache")
+        {
+            CHECK(3 == oltcOf(first));
+            CHECK(first == second);
+            const RecordCacheStats stats = cache->stats();
+            CHECK(1 == stats.hits);
+            CHECK(1 == stats.misses);
+            CHECK(1 == stats.entries);
+        }
+    }
+    WHEN("The creator overwrites cached records")
+    {
+        reader.ReadCachedMsg(3, prototype);
+        reader.ReadCachedMsg(4, prototype);
+        setRecorderValues(msg.get(), 33, 0, 0);
+        creator.writeMsg(3, msg.get());
+        setRecorderValues(msg.get(), 44, 0, 0);
+        creator.appendMsg(4, msg.get());
+        THEN("A pending record stays cached until it is committed")
+        {
+            reader.TryCatchUpWithPrimary();
+            CHECK(33 == oltcOf(reader.ReadCachedMsg(3, prototype)));
+            CHECK(4 == oltcOf(reader.ReadCachedMsg(4, prototype)));
+            creator.flush();
+            reader.TryCatchUpWithPrimary();
+            CHECK(44 == oltcOf(reader.ReadCachedMsg(4, prototype)));
+            CHECK(2 == cache->stats().invalidations);
+        }
+    }
+    WHEN("A record is invalidated between lookup and insert")
+    {
+        RecordCache::Ticket ticket = 0;
+        CHECK_FALSE(cache->lookup(recorderDesc, 5, ticket));
+        const auto stale = reader.ReadCachedMsg(5, prototype);
+        cache->invalidate(5);
+        cache->insert(5, stale, ticket);
+        THEN("The outdated insert is dropped")
+        {
+            RecordCache::Ticket unused = 0;
+            CHECK_FALSE(cache->lookup(recorderDesc, 5, unused));
+        }
+    }
+    WHEN("The cache is full")
+    {
+        auto small = std::make_shared<RecordCache>(1024, 1);
+        reader.setRecordCache(small);
+        for (uint32_t round = 0; round < 2; ++round)
+        {
+            for (uint64_t index = 0; index < 10; ++index)
+            {
+                CHECK(index == oltcOf(reader.ReadCachedMsg(index, prototype)));
+            }
+        }
+        THEN("The least recently used records are evicted")
+        {
+            const RecordCacheStats stats = small->stats();
+            CHECK(0 < stats.evictions);
+            CHECK(stats.bytes <= 1024);
+            CHECK(20 == stats.hits + stats.misses);
+        }
+    }
+}
+
+TEST_CASE_METHOD(databaseFixture, "Schema registry")
+{
+    constexpr const char *eventText = R"(syntax = "proto3";
+message event
+{
+    string source = 1;
+})";
+    constexpr const char *eventV2Text = R"(syntax = "proto3";
+message event
+{
+    string source = 1;
+    uint32 severity = 2;
+})";
+    const google::protobuf::Descriptor *eventDesc = msgCreator.createMessageDesc(eventText, "event");
+    std::unique_ptr<google::protobuf::Message> event(msgCreator.createNewMessage(eventDesc));
+    recorderDesc = msgCreator.createMessageDesc(recorderText, "recorder_1");
+    std::unique_ptr<google::protobuf::Message> msg(msgCreator.createNewMessage(recorderDesc));
+    const google::protobuf::FieldDescriptor *source = eventDesc->FindFieldByName("source");
+    const google::protobuf::FieldDescriptor *oltc   = recorderDesc->FindFieldByName("oltc");
+    uint32_t recorderId = 0;
+    uint32_t eventId    = 0;
+    {
+        DBCreator creator;
+        creator.create(filepath);
+        creator.createNewColumn("desc");
+        creator.createTypedColumn();
+        recorderId = creator.registerSchema(recorderText, "recorder_1");
+        eventId    = creator.registerSchema(eventText, "event");
+        CHECK(1 == recorderId);
+        CHECK(2 == eventId);
+        // the same schema again keeps its id, a changed one gets a new id
+        CHECK(eventId == creator.registerSchema(eventText, "event"));
+        CHECK(3 == creator.registerSchema(eventV2Text, "event"));
+        CHECK_THROWS_AS(creator.registerSchema(eventText, "unknown"), std::invalid_argument);
+        // records of a different type are refused
+        CHECK_THROWS_AS(creator.writeTypedMsg(eventId, 0, msg.get()), std::invalid_argument);
+        // chunked columns can't take the name of the typed column
+        CHECK_THROWS_AS(creator.createChunkedColumn(typedRecordColumn, 16), std::invalid_argument);
+        CHECK_THROWS_AS(creator.createChunkedColumn("desc", 16), std::invalid_argument);
+
+        for (uint32_t ctr = 0; ctr < 100; ++ctr)
+        {
+            setRecorderValues(msg.get(), ctr, 0, 0);
+            creator.appendTypedMsg(recorderId, ctr, msg.get());
+            if (0 == ctr % 2)
+            {
+                event->GetReflection()->SetString(event.get(), source, "event " + std::to_string(ctr));
+                creator.writeTypedMsg(eventId, ctr, event.get());
+            }
+        }
+    }
+    DBReader reader;
+    reader.Open(filepath);
+    WHEN("I open the database")
+    {
+        const SchemaRegistry &schemas = reader.Schemas();
+        THEN("The registry is loaded from the desc column")
+        {
+            CHECK(3 == schemas.size());
+            REQUIRE(schemas.find("event"));
+            CHECK(3 == schemas.find("event")->id);
+            CHECK("recorder_1" == schemas.require(recorderId).desc->name());
+            CHECK_FALSE(schemas.find(4));
+        }
+    }
+    WHEN("I read the records of one type")
+    {
+        std::vector<uint64_t> indices;
+        const size_t numRead = reader.ReadTypedRange(eventId, 10, 20, [&](uint64_t index, const rocksdb::Slice &) { indices.push_back(index); });
+        THEN("Only records of that type are visited")
+        {
+            CHECK(5 == numRead);
+            CHECK(std::vector<uint64_t>{10, 12, 14, 16, 18} == indices);
+            CHECK(0 == reader.ReadTypedRange(3, 0, 100, [](uint64_t, const rocksdb::Slice &) {}));
+        }
+    }
+    WHEN("I read single records")
+    {
+        const std::unique_ptr<google::protobuf::Message> record = reader.ReadTypedMsg(eventId, 42);
+        THEN("The message type is resolved from the registry")
+        {
+            CHECK("event" == record->GetDescriptor()->name());
+            CHECK("event 42" == record->GetReflection()->GetString(*record, record->GetDescriptor()->FindFieldByName("source")));
+            const std::unique_ptr<google::protobuf::Message> recorder = reader.ReadTypedMsg(recorderId, 42);
+            CHECK(42 == recorder->GetReflection()->GetUInt32(*recorder, oltc));
+            CHECK_THROWS_AS(reader.ReadTypedMsg(eventId, 43), std::invalid_argument);
+        }
+    }
+    WHEN("I read all types")
+    {
+        std::map<std::string, size_t> counts;
+        const size_t numRead = reader.ReadAllTypes(0, 100, [&](const RegisteredSchema &schema, uint64_t, const google::protobuf::Message &record) {
+            CHECK(schema.desc == record.GetDescriptor());
+            ++counts[record.GetDescriptor()->name()];
+        });
+        THEN("Every record is parsed with its own type")
+        {
+            CHECK(150 == numRead);
+            CHECK(100 == counts["recorder_1"]);
+            CHECK(50 == counts["event"]);
+        }
+    }
+}
+
+TEST_CASE_METHOD(databaseFixture, "Scan filter")
+{
+    constexpr const char *eventText = R"(syntax = "proto3";
+message event
+{
+    string source = 1;
+    sint32 delta = 2;
+    double level = 3;
+    repeated int32 samples = 4;
+})";
+    const google::protobuf::Descriptor *eventDesc = msgCreator.createMessageDesc(eventText, "event");
+    std::unique_ptr<google::protobuf::Message> event(msgCreator.createNewMessage(eventDesc));
+    const google::protobuf::Reflection *reflection = event->GetReflection();
+    std::unique_ptr<google::protobuf::Message> msg(msgCreator.createNewMessage(recorderDesc));
+    {
+        DBCreator creator;
+        creator.create(filepath);
+        for (uint32_t ctr = 0; ctr < 100; ++ctr)
+        {
+            setRecorderValues(msg.get(), ctr % 10, static_cast<int32_t>(ctr) - 50, 0);
+            creator.appendMsg(ctr, msg.get());
+        }
+    }
+    auto serialize = [&event]() { return event->SerializeAsString(); };
+
+    WHEN("I filter on numeric fields")
+    {
+        ScanFilter filter(recorderDesc);
+        filter.where("voltage", CompareOp::Greater, -10).where("voltage", CompareOp::LessEqual, 10).where("oltc", CompareOp::Equal, 5u);
+        DBReader reader;
+        reader.Open(filepath);
+        std::vector<uint64_t> indices;
+        const size_t numRead =
+            reader.ReadRangeFiltered(0, 100, filter, [&indices](uint64_t index, const rocksdb::Slice &) { indices.push_back(index); });
+        THEN("Only the matching records are visited")
+        {
+            CHECK(2 == numRead);
+            CHECK(std::vector<uint64_t>{45, 55} == indices);
+            CHECK(100 == reader.ReadRangeFiltered(0, 100, ScanFilter(recorderDesc), [](uint64_t, const rocksdb::Slice &) {}));
+        }
+        THEN("The message overload parses the matching records only")
+        {
+            const google::protobuf::FieldDescriptor *voltage = recorderDesc->FindFieldByName("voltage");
+            int32_t sum                                      = 0;
+            reader.ReadRangeFiltered(0, 100, filter, msg.get(), [&](uint64_t, const google::protobuf::Message &record) {
+                sum += record.GetReflection()->GetInt32(record, voltage);
+            });
+            CHECK(0 == sum);
+        }
+        THEN("Values out of the field's range don't wrap around")
+        {
+            auto count = [&reader](const ScanFilter &outOfRange) {
+                return reader.ReadRangeFiltered(0, 100, outOfRange, [](uint64_t, const rocksdb::Slice &) {});
+            };
+            // oltc is unsigned, every value is greater than -1
+            CHECK(100 == count(ScanFilter(recorderDesc).where("oltc", CompareOp::Greater, -1)));
+            CHECK(0 == count(ScanFilter(recorderDesc).where("oltc", CompareOp::Equal, -1)));
+            CHECK(0 == count(ScanFilter(recorderDesc).where("oltc", CompareOp::LessEqual, int64_t(-1))));
+            // voltage is signed, every value is less than UINT64_MAX
+            CHECK(100 == count(ScanFilter(recorderDesc).where("voltage", CompareOp::Less, UINT64_MAX)));
+            CHECK(0 == count(ScanFilter(recorderDesc).where("voltage", CompareOp::GreaterEqual, UINT64_MAX)));
+        }
+    }
+    WHEN("I filter on string, zigzag and double fields")
+    {
+        ScanFilter filter(eventDesc);
+        filter.where("source", CompareOp::Equal, "feeder 3").where("delta", CompareOp::Less, -2).where("level", CompareOp::GreaterEqual, 0.5);
+        reflection->SetString(event.get(), eventDesc->FindFieldByName("source"), "feeder 3");
+        reflection->SetInt32(event.get(), eventDesc->FindFieldByName("delta"), -3);
+        reflection->SetDouble(event.get(), eventDesc->FindFieldByName("level"), 0.5);
+        reflection->AddInt32(event.get(), eventDesc->FindFieldByName("samples"), 7);
+        THEN("Each clause is evaluated on the wire value")
+        {
+            std::string data = serialize();
+            CHECK(filter.matches(data.data(), data.size()));
+            reflection->SetInt32(event.get(), eventDesc->FindFieldByName("delta"), 3);
+            data = serialize();
+            CHECK_FALSE(filter.matches(data.data(), data.size()));
+            reflection->SetInt32(event.get(), eventDesc->FindFieldByName("delta"), -3);
+            reflection->SetString(event.get(), eventDesc->FindFieldByName("source"), "feeder 33");
+            data = serialize();
+            CHECK_FALSE(filter.matches(data.data(), data.size()));
+        }
+        THEN("Absent fields compare with their default value")
+        {
+            ScanFilter defaults(eventDesc);
+            defaults.where("source", CompareOp::NotEqual, "feeder 3").where("delta", CompareOp::Equal, 0);
+            CHECK(defaults.matches("", 0));
+            CHECK_FALSE(filter.matches("", 0));
+        }
+        THEN("Malformed records are reported")
+        {
+            const std::string data = serialize();
+            CHECK_THROWS_AS(filter.matches(data.data(), data.size() - 1), std::invalid_argument);
+        }
+    }
+    WHEN("I add invalid clauses")
+    {
+        ScanFilter filter(eventDesc);
+        THEN("They are refused")
+        {
+            CHECK_THROWS_AS(filter.where("unknown", CompareOp::Equal, 1), std::invalid_argument);
+            CHECK_THROWS_AS(filter.where("samples", CompareOp::Equal, 1), std::invalid_argument);
+            CHECK_THROWS_AS(filter.where("source", CompareOp::Less, "a"), std::invalid_argument);
+            CHECK_THROWS_AS(filter.where("source", CompareOp::Equal, 1), std::invalid_argument);
+            CHECK(0 == filter.size());
+        }
+    }
+}
+
+TEST_CASE_METHOD(databaseFixture, "Rollups")
+{
+    std::unique_ptr<google::protobuf::Message> msg(msgCreator.createNewMessage(recorderDesc));
+    RollupOptions rollups;
+    rollups.widths = {1000, 60 * 1000};
+    {
+        DBCreator creator;
+        creator.create(filepath);
+        creator.createTimeIndexColumn();
+        creator.createRollupColumns(rollups);
+        BatchOptions options;
+        options.maxCount = 64;
+        creator.setBatchOptions(options);
+        // one sample per 100 ms for 3 minutes
+        for (uint32_t ctr = 0; ctr < 1800; ++ctr)
+        {
+            setRecorderValues(msg.get(), ctr % 10, static_cast<int32_t>(ctr), -static_cast<int32_t>(ctr));
+            creator.appendMsg(ctr, 100 * ctr, msg.get());
+        }
+        // a late sample goes into its old bucket
+        setRecorderValues(msg.get(), 0, 100000, 0);
+        creator.writeMsg(1800, 50, msg.get());
+        // a record of another type is refused as a whole, the pending batch stays consistent
+        const size_t pending = creator.pendingMsgs();
+        msgDesc other;
+        CHECK_THROWS_AS(creator.appendMsg(1801, 60, &other), std::invalid_argument);
+        CHECK(pending == creator.pendingMsgs());
+        CHECK_THROWS_AS(creator.createRollupColumns(rollups), std::invalid_argument);
+        CHECK_THROWS_AS(creator.createChunkedColumn("rollup/chunks", 16), std::invalid_argument);
+        // other column names with the prefix are no rollup columns
+        CHECK(60 * 1000 == rollupWidth(rollupColumn(60 * 1000)));
+        CHECK(0 == rollupWidth("rollup/"));
+        CHECK(0 == rollupWidth("rollup/chunks"));
+        CHECK(0 == rollupWidth("rollup/10s"));
+        CHECK(0 == rollupWidth("rollup/0"));
+        CHECK(0 == rollupWidth("rollup/99999999999999999999"));
+    }
+    DBReader reader;
+    reader.Open(filepath);
+    RowDecoder decoder(msgCreator.prototype(recorderDesc));
+    const size_t voltage = static_cast<size_t>(decoder.slot("voltage"));
+
+    WHEN("I read the seconds of a range")
+    {
+        std::vector<RollupBucket> buckets;
+        const size_t numRead = reader.ReadRollup(1000, 500, 3000, [&buckets](const RollupBucket &bucket) { buckets.push_back(bucket); });
+        THEN("Every bucket aggregates its samples")
+        {
+            REQUIRE(3 == numRead);
+            CHECK(0 == buckets[0].start);
+            CHECK(11 == buckets[0].count);
+            CHECK(100000 == buckets[0].fields[voltage].max);
+            CHECK(2000 == buckets[2].start);
+            CHECK(10 == buckets[2].count);
+            CHECK(20 == buckets[2].fields[voltage].min);
+            CHECK(29 == buckets[2].fields[voltage].max);
+            CHECK(245 == buckets[2].fields[voltage].sum);
+            CHECK(24.5 == buckets[2].mean(voltage));
+            CHECK(-29 == buckets[2].fields[decoder.slot("current")].min);
+        }
+    }
+    WHEN("I read with a point budget")
+    {
+        THEN("The finest resolution within the budget is chosen")
+        {
+            CHECK(std::vector<uint64_t>{1000, 60000} == reader.RollupWidths());
+            CHECK(1000 == reader.ChooseRollupWidth(0, 180000, 180));
+            CHECK(60000 == reader.ChooseRollupWidth(0, 180000, 179));
+            CHECK(60000 == reader.ChooseRollupWidth(0, 180000, 1));
+            uint64_t count = 0;
+            CHECK(3 == reader.ReadRollups(0, 180000, 100, [&count](const RollupBucket &bucket) {
+                CHECK(60000 == bucket.width);
+                count += bucket.count;
+            }));
+            CHECK(1801 == count);
+        }
+    }
+}
+
+TEST_CASE_METHOD(databaseFixture, "Retention")
+{
+    std::unique_ptr<google::protobuf::Message> msg(msgCreator.createNewMessage(recorderDesc));
+    RetentionPolicy policy;
+    policy.maxAge[rocksdb::kDefaultColumnFamilyName] = 50000;
+    policy.maxAge[timeIndexColumn]                   = 50000;
+    policy.maxAge[rollupColumn(10000)]               = 30000;
+    RollupOptions rollups;
+    rollups.widths = {10000};
+    auto fill      = [&](DBCreator &creator) {
+        creator.setRetention(policy);
+        creator.create(filepath);
+        creator.createNewColumn("desc");
+        creator.createTimeIndexColumn();
+        creator.createRollupColumns(rollups);
+        // one record per second
+        for (uint32_t ctr = 0; ctr < 100; ++ctr)
+        {
+            setRecorderValues(msg.get(), ctr, 0, 0);
+            creator.appendMsg(ctr, 1000 * ctr, msg.get());
+        }
+        creator.flush();
+    };
+    auto count = [this](const std::string &column) {
+        DBReader reader;
+        reader.Open(filepath);
+        size_t ctr = 0;
+        if (column == rocksdb::kDefaultColumnFamilyName)
+        {
+            ctr = reader.ReadRange(0, UINT64_MAX, [](uint64_t, const rocksdb::Slice &) {});
+        }
+        else if (column == timeIndexColumn)
+        {
+            ctr = reader.ReadTimeRange(0, UINT64_MAX, [](uint64_t, uint64_t, const rocksdb::Slice &) {});
+        }
+        else
+        {
+            ctr = reader.ReadRollup(10000, 0, UINT64_MAX, [](const RollupBucket &) {});
+        }
+        return ctr;
+    };
+
+    WHEN("The policy covers unsupported columns")
+    {
+        DBCreator creator;
+        RetentionPolicy unsupported;
+        unsupported.maxAge["desc"] = 1000;
+        CHECK_THROWS_AS(creator.setRetention(unsupported), std::invalid_argument);
+        unsupported.maxAge = {{typedRecordColumn, 1000}};
+        CHECK_THROWS_AS(creator.setRetention(unsupported), std::invalid_argument);
+        THEN("Record retention without the time index is reported by expire")
+        {
+            unsupported.maxAge = {{rocksdb::kDefaultColumnFamilyName, 1000}};
+            creator.setRetention(unsupported);
+            creator.create(filepath);
+            CHECK_THROWS_WITH(creator.expire(5000), "Retention on the records requires the time index column");
+        }
+    }
+    WHEN("The data expires")
+    {
+        {
+            DBCreator creator;
+            fill(creator);
+            creator.expire(100000);
+            // the cutoff never moves back
+            creator.expire(90000);
+            creator.compactExpired();
+        }
+        THEN("Compactions drop what is older than the maximum age of its column")
+        {
+            CHECK(50 == count(rocksdb::kDefaultColumnFamilyName));
+            CHECK(50 == count(timeIndexColumn));
+            // buckets ending after 70 s
+            CHECK(3 == count(rollupColumn(10000)));
+            DBReader reader;
+            reader.Open(filepath);
+            CHECK_THROWS_AS(reader.ReadMsg(49, msg.get()), std::invalid_argument);
+            reader.ReadMsg(50, msg.get());
+            CHECK(50 == msg->GetReflection()->GetUInt32(*msg, recorderDesc->FindFieldByName("oltc")));
+        }
+    }
+    WHEN("Nothing expired yet")
+    {
+        {
+            DBCreator creator;
+            fill(creator);
+            creator.expire(30000);
+            creator.compactExpired();
+        }
+        THEN("Everything is kept")
+        {
+            CHECK(100 == count(rocksdb::kDefaultColumnFamilyName));
+            CHECK(100 == count(timeIndexColumn));
+            CHECK(10 == count(rollupColumn(10000)));
+        }
+    }
+}
+
+TEST_CASE_METHOD(databaseFixture, "Typed store")
+{
+    static_assert(IndexKeyCodec::encode(258)[6] == 1 && IndexKeyCodec::encode(258)[7] == 2, "index keys are big endian");
+    static_assert(SchemaKeyCodec<3>::encode(1)[3] == 3, "the schema id is the key prefix");
+    msgDesc desc;
+    desc.set_measurement(7);
+    desc.set_measdescription(recorderText);
+    {
+        DBCreator creator;
+        creator.create(filepath);
+        creator.createNewColumn("desc");
+        TypedStore<msgDesc, IndexKeyCodec> records = creator.typedStore<msgDesc, IndexKeyCodec>();
+        rocksdb::WriteBatch batch;
+        for (uint64_t ctr = 0; ctr < 10; ++ctr)
+        {
+            desc.set_startindex(ctr);
+            records.put(batch, ctr, desc);
+        }
+        records.write(batch);
+        desc.set_startindex(42);
+        creator.typedStore<msgDesc, DescKeyCodec>().put("recorder", desc);
+        CHECK_THROWS_AS((creator.typedStore<msgDesc, SchemaKeyCodec<1>>()), std::invalid_argument);
+    }
+    DBReader reader;
+    reader.Open(filepath);
+    WHEN("I read typed records")
+    {
+        TypedStore<msgDesc, IndexKeyCodec> records = reader.OpenTypedStore<msgDesc, IndexKeyCodec>();
+        std::vector<uint64_t> indices;
+        const size_t numRead = records.scan(2, 5, desc, [&indices](uint64_t index, const msgDesc &record) {
+            CHECK(index == record.startindex());
+            indices.push_back(index);
+        });
+        THEN("Keys and records round trip")
+        {
+            CHECK(std::vector<uint64_t>{2, 3, 4} == indices);
+            CHECK(3 == numRead);
+            CHECK(9 == records.get(9).startindex());
+            CHECK(7 == records.get(9).measurement());
+            CHECK_THROWS_AS(records.get(10), std::invalid_argument);
+            CHECK(42 == reader.OpenTypedStore<msgDesc, DescKeyCodec>().get("recorder").startindex());
+        }
+        THEN("The dynamic API reads the same records")
+        {
+            CHECK(42 == reader.ReadDesc("recorder").startindex());
+            const std::string schemaText                    = msgDesc::descriptor()->file()->DebugString();
+            const google::protobuf::Descriptor *dynamicDesc = msgCreator.createMessageDesc(schemaText.c_str(), "msgDesc");
+            std::unique_ptr<google::protobuf::Message> dynamic(msgCreator.createNewMessage(dynamicDesc));
+            reader.ReadMsg(5, dynamic.get());
+            CHECK(5 == dynamic->GetReflection()->GetUInt64(*dynamic, dynamicDesc->FindFieldByName("startIndex")));
+        }
+    }
+}
+
+TEST_CASE_METHOD(databaseFixture, "Async reads")
+{
+    std::unique_ptr<google::protobuf::Message> msg(msgCreator.createNewMessage(recorderDesc));
+    {
+        DBCreator creator;
+        creator.create(filepath);
+        creator.createNewColumn("desc");
+        for (uint32_t ctr = 0; ctr < 100; ++ctr)
+        {
+            setRecorderValues(msg.get(), ctr, 0, 0);
+            creator.appendMsg(ctr, msg.get());
+        }
+        msgDesc desc;
+        desc.set_measurement(7);
+        creator.writeDesc("recorder", desc);
+    }
+    DBReader reader;
+    reader.Open(filepath);
+    AsyncReader async(reader, 4);
+    const google::protobuf::FieldDescriptor *oltc = recorderDesc->FindFieldByName("oltc");
+
+    WHEN("Many reads are in flight")
+    {
+        std::vector<uint64_t> indices(100);
+        std::iota(indices.begin(), indices.end(), 0);
+        std::vector<std::future<StatusOr<std::string>>> futures = async.ReadMsgs(indices);
+        std::vector<std::future<StatusOr<std::unique_ptr<google::protobuf::Message>>>> parsed;
+        for (uint64_t index : indices)
+        {
+            parsed.push_back(async.ReadMsg(index, msgCreator.prototype(recorderDesc)));
+        }
+        THEN("Every future gets its own record")
+        {
+            CHECK(4 == async.concurrency());
+            for (uint64_t index : indices)
+            {
+                StatusOr<std::string> raw = futures[index].get();
+                REQUIRE(raw.ok());
+                CHECK(reader.ReadMsg(index) == raw.value);
+                StatusOr<std::unique_ptr<google::protobuf::Message>> record = parsed[index].get();
+                REQUIRE(record.ok());
+                CHECK(index == record.value->GetReflection()->GetUInt32(*record.value, oltc));
+            }
+            StatusOr<msgDesc> desc = async.ReadDesc("recorder").get();
+            REQUIRE(desc.ok());
+            CHECK(7 == desc.value.measurement());
+        }
+    }
+    WHEN("Reads fail")
+    {
+        constexpr const char *strictText = R"(syntax = "proto2";
+message strict
+{
+    required string name = 4;
+})";
+        const google::protobuf::Message &strict = msgCreator.prototype(msgCreator.createMessageDesc(strictText, "strict"));
+        StatusOr<std::string> missing                                    = async.ReadMsg(1000).get();
+        StatusOr<msgDesc> missingDesc                                    = async.ReadDesc("unknown").get();
+        StatusOr<std::unique_ptr<google::protobuf::Message>> wrongRecord = async.ReadMsg(0, strict).get();
+        THEN("The status is returned instead of an exception")
+        {
+            CHECK(missing.status.IsNotFound());
+            CHECK(missing.value.empty());
+            CHECK(missingDesc.status.IsNotFound());
+            CHECK(wrongRecord.status.IsCorruption());
+            CHECK_FALSE(wrongRecord.value);
+        }
+    }
+}
@@ -0,0 +1,828 @@
+#pragma once
+
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <rocksdb/convenience.h>
+#include <rocksdb/db.h>
+#include <rocksdb/write_batch.h>
+
+#include <google/protobuf/message.h>
+
+#include <desc.pb.h>
+
+#include "chunkFormat.h"
+#include "dbMetrics.h"
+#include "keyCodec.h"
+#include "recordCache.h"
+#include "retention.h"
+#include "rollup.h"
+#include "rowDecoder.h"
+#include "schemaCache.h"
+#include "schemaRegistry.h"
+#include "typedStore.h"
+
+/**
+ * @brief Thresholds for DBCreator::appendMsg. The pending batch is committed as soon as
+ * one of them is reached. The age is only checked while appending, there is no timer thread.
+ */
+struct BatchOptions
+{
+    size_t maxCount = 1000;
+    size_t maxBytes = 4 * 1024 * 1024;
+    std::chrono::milliseconds maxDelay{100};
+    // used by every write of the creator; a reader following it with OpenAsSecondary needs the WAL,
+    // it doesn't see records which are only in the memtable
+    bool disableWAL = true;
+};
+
+/**
+ * @brief Column family with a RetentionPolicy entry and its compaction filter
+ */
+struct RetentionColumn
+{
+    rocksdb::ColumnFamilyHandle *handle = nullptr;
+    uint64_t maxAge                     = 0;
+    std::unique_ptr<RetentionFilter> filter;
+};
+
+/**
+ * @brief Writer state of a column family holding chunked records, see chunkFormat.h
+ */
+struct ChunkedColumn
+{
+    rocksdb::ColumnFamilyHandle *handle      = nullptr;
+    uint64_t chunkSize                       = 0;
+    ChunkEncoding encoding                   = ChunkEncoding::Records;
+    const google::protobuf::Descriptor *desc = nullptr;
+    ChunkBuilder builder;
+    bool dirty = false;
+};
+
+class DBCreator
+{
+    friend class BulkImporter;
+    friend class IngestPipeline;
+
+private:
+    rocksdb::DB *_db                              = nullptr;
+    rocksdb::ColumnFamilyHandle *_descHandle      = nullptr;
+    rocksdb::ColumnFamilyHandle *_timeIndexHandle = nullptr;
+    rocksdb::ColumnFamilyHandle *_typedHandle     = nullptr;
+    SchemaRegistry _registry;
+
+    BatchOptions _batchOptions;
+    rocksdb::WriteBatch _batch;
+    size_t _pendingMsgs = 0;
+    std::string _buffer;
+    std::chrono::steady_clock::time_point _batchStart;
+    std::map<std::string, ChunkedColumn> _chunkedColumns;
+    DBMetrics _metrics;
+    std::shared_ptr<RecordCache> _cache;
+    // indices of the pending batch, only tracked with a cache
+    std::vector<uint64_t> _pendingIndices;
+    std::vector<std::pair<uint64_t, rocksdb::ColumnFamilyHandle *>> _rollupHandles;
+    // decoder of the first timestamped record, its numeric fields are rolled up
+    const google::protobuf::Descriptor *_rollupDesc = nullptr;
+    std::unique_ptr<RowDecoder> _rollupDecoder;
+    std::vector<double> _rollupRow;
+    std::string _rollupOperand;
+    RetentionPolicy _retention;
+    std::map<std::string, RetentionColumn> _retentionColumns;
+
+    void serialize(const google::protobuf::Message *msg, std::string &output)
+    {
+        DBMetrics::Timer timer(_metrics, DBOperation::Serialize);
+        msg->SerializeToString(&output);
+    }
+
+    rocksdb::Status write(const rocksdb::WriteOptions &options, rocksdb::WriteBatch *batch)
+    {
+        DBMetrics::Timer timer(_metrics, DBOperation::Put);
+        return _db->Write(options, batch);
+    }
+
+    /**
+     * @brief Commit of the writer threads of IngestPipeline: timed like the own commits, the indices are invalidated
+     * in the record cache set at the time of the commit. Called concurrently, see setRecordCache.
+     */
+    rocksdb::Status commitExternal(const rocksdb::WriteOptions &options, rocksdb::WriteBatch &batch, const std::vector<uint64_t> &indices)
+    {
+        rocksdb::Status status = write(options, &batch);
+        if (std::shared_ptr<RecordCache> cache = std::atomic_load(&_cache))
+        {
+            for (uint64_t index : indices)
+            {
+                cache->invalidate(index);
+            }
+        }
+        return status;
+    }
+
+    rocksdb::ColumnFamilyHandle *timeIndexHandle() const
+    {
+        if (!_timeIndexHandle)
+        {
+            throw std::invalid_argument("Time index column not created");
+        }
+        return _timeIndexHandle;
+    }
+
+    /**
+     * @brief Encodes the serialized record as rollup merge operand, before anything of the record is written
+     * @return false if there are no rollup columns
+     */
+    bool encodeRollup(const google::protobuf::Message *msg, const std::string &record)
+    {
+        if (_rollupHandles.empty())
+        {
+            return false;
+        }
+        if (!_rollupDecoder)
+        {
+            _rollupDesc    = msg->GetDescriptor();
+            _rollupDecoder = std::make_unique<RowDecoder>(*msg);
+            _rollupRow.resize(_rollupDecoder->size());
+        }
+        else if (_rollupDesc->full_name() != msg->GetDescriptor()->full_name())
+        {
+            throw std::invalid_argument("Rollups hold " + _rollupDesc->full_name() + " records");
+        }
+        if (!_rollupDecoder->decode(record.data(), record.size(), _rollupRow.data()))
+        {
+            throw std::invalid_argument("Error while parsing");
+        }
+        RollupCodec::encodeSample(_rollupRow.data(), _rollupRow.size(), _rollupOperand);
+        return true;
+    }
+
+    /**
+     * @brief Adds the operand of encodeRollup to its bucket of every rollup width
+     */
+    void mergeRollups(rocksdb::WriteBatch &batch, uint64_t timestamp)
+    {
+        for (const auto &[width, handle] : _rollupHandles)
+        {
+            batch.Merge(handle, toSlice(encodeIndexKey(timestamp - timestamp % width)), _rollupOperand);
+        }
+    }
+
+    /**
+     * @return compaction filter for the column, nullptr if the retention policy keeps its data
+     */
+    std::unique_ptr<RetentionFilter> retentionFilter(const std::string &column, uint64_t span) const
+    {
+        auto maxAge = _retention.maxAge.find(column);
+        if (maxAge == _retention.maxAge.end() || 0 == maxAge->second)
+        {
+            return nullptr;
+        }
+        return std::make_unique<RetentionFilter>(span);
+    }
+
+    /**
+     * @brief Keeps the filter of a created column family alive until the database is closed
+     */
+    void addRetention(const std::string &column, rocksdb::ColumnFamilyHandle *handle, std::unique_ptr<RetentionFilter> filter)
+    {
+        if (filter)
+        {
+            _retentionColumns[column] = RetentionColumn{handle, _retention.maxAge.at(column), std::move(filter)};
+        }
+    }
+
+    /**
+     * @brief Index of the first record with a timestamp of at least cutoff, indices are expected to grow with the timestamps.
+     * If every indexed record is older, the index after the last one.
+     */
+    uint64_t firstIndexAfter(uint64_t cutoff)
+    {
+        std::unique_ptr<rocksdb::Iterator> iter(_db->NewIterator(rocksdb::ReadOptions(), timeIndexHandle()));
+        iter->Seek(toSlice(encodeTimeIndexKey(cutoff, 0)));
+        uint64_t index = 0;
+        if (iter->Valid())
+        {
+            index = decodeTimeIndexKey(iter->key()).second;
+        }
+        else
+        {
+            iter->SeekToLast();
+            index = iter->Valid() ? decodeTimeIndexKey(iter->key()).second + 1 : 0;
+        }
+        if (!iter->status().ok())
+        {
+            throw std::invalid_argument(iter->status().ToString());
+        }
+        return index;
+    }
+
+    /**
+     * @return handle of a column family created by this creator, nullptr if there is none with the name
+     */
+    rocksdb::ColumnFamilyHandle *columnHandle(const std::string &name) const
+    {
+        if (name == rocksdb::kDefaultColumnFamilyName)
+        {
+            return _db->DefaultColumnFamily();
+        }
+        for (rocksdb::ColumnFamilyHandle *handle : {_descHandle, _timeIndexHandle, _typedHandle})
+        {
+            if (handle && handle->GetName() == name)
+            {
+                return handle;
+            }
+        }
+        auto chunked = _chunkedColumns.find(name);
+        return chunked == _chunkedColumns.end() ? nullptr : chunked->second.handle;
+    }
+
+    void appendRecord(uint64_t index, const google::protobuf::Message *msg)
+    {
+        serialize(msg, _buffer);
+        appendSerialized(index);
+    }
+
+    /**
+     * @brief Adds the record in _buffer to the pending batch
+     */
+    void appendSerialized(uint64_t index)
+    {
+        if (0 == _pendingMsgs)
+        {
+            _batchStart = std::chrono::steady_clock::now();
+        }
+        _batch.Put(toSlice(encodeIndexKey(index)), _buffer);
+        ++_pendingMsgs;
+        if (_cache)
+        {
+            _pendingIndices.push_back(index);
+        }
+    }
+
+    /**
+     * @return handle of the typed record column, after checking that msg is of the registered type
+     */
+    rocksdb::ColumnFamilyHandle *typedHandle(uint32_t schemaId, const google::protobuf::Message *msg) const
+    {
+        if (!_typedHandle)
+        {
+            throw std::invalid_argument("Typed record column not created");
+        }
+        const RegisteredSchema &registered = _registry.require(schemaId);
+        if (registered.desc->full_name() != msg->GetDescriptor()->full_name())
+        {
+            throw std::invalid_argument("Schema " + std::to_string(schemaId) + " holds " + registered.desc->full_name() + " records");
+        }
+        return _typedHandle;
+    }
+
+    static void serializeDesc(const msgDesc &desc, std::string &output)
+    {
+        if (desc.measdescriptorproto().empty() && !desc.measdescription().empty())
+        {
+            msgDesc withProto(desc);
+            withProto.set_measdescriptorproto(SchemaCache::instance().fromText(desc.measdescription())->fileDescriptorProto());
+            withProto.SerializeToString(&output);
+        }
+        else
+        {
+            desc.SerializeToString(&output);
+        }
+    }
+
+    /**
+     * @return true for the names of the column families with a fixed meaning, readers open them by name
+     */
+    static bool reservedColumn(const std::string &name)
+    {
+        return name == rocksdb::kDefaultColumnFamilyName || name == "desc" || name == timeIndexColumn || name == typedRecordColumn ||
+               0 == name.compare(0, std::strlen(rollupColumnPrefix), rollupColumnPrefix);
+    }
+
+    ChunkedColumn &chunkedColumn(const char *name)
+    {
+        auto it = _chunkedColumns.find(name);
+        if (it == _chunkedColumns.end())
+        {
+            throw std::invalid_argument(std::string("Chunked column ") + name + " not created");
+        }
+        return it->second;
+    }
+
+    void putChunk(ChunkedColumn &column)
+    {
+        if (column.dirty)
+        {
+            _batch.Put(column.handle, toSlice(encodeIndexKey(column.builder.start())), column.builder.finish());
+            column.dirty = false;
+        }
+    }
+
+    void putChunks()
+    {
+        for (auto &it : _chunkedColumns)
+        {
+            putChunk(it.second);
+        }
+    }
+
+    void invalidatePending()
+    {
+        if (_cache)
+        {
+            for (uint64_t index : _pendingIndices)
+            {
+                _cache->invalidate(index);
+            }
+        }
+        _pendingIndices.clear();
+    }
+
+    void flushIfDue()
+    {
+        if (_pendingMsgs >= _batchOptions.maxCount || _batch.GetDataSize() >= _batchOptions.maxBytes ||
+            std::chrono::steady_clock::now() - _batchStart >= _batchOptions.maxDelay)
+        {
+            flush();
+        }
+    }
+
+public:
+    ~DBCreator()
+    {
+        if (_db)
+        {
+            putChunks();
+            if (_batch.Count())
+            {
+                rocksdb::WriteOptions options;
+                options.disableWAL = _batchOptions.disableWAL;
+                _db->Write(options, &_batch);
+                invalidatePending();
+            }
+            if (_descHandle)
+            {
+                _db->DestroyColumnFamilyHandle(_descHandle);
+            }
+            if (_timeIndexHandle)
+            {
+                _db->DestroyColumnFamilyHandle(_timeIndexHandle);
+            }
+            if (_typedHandle)
+            {
+                _db->DestroyColumnFamilyHandle(_typedHandle);
+            }
+            for (auto &it : _chunkedColumns)
+            {
+                _db->DestroyColumnFamilyHandle(it.second.handle);
+            }
+            for (auto &it : _rollupHandles)
+            {
+                _db->DestroyColumnFamilyHandle(it.second);
+            }
+            _db->Close();
+            delete _db;
+        }
+    }
+
+    void create(const std::filesystem::path &path)
+    {
+        rocksdb::Options opts;
+        opts.error_if_exists      = true;
+        opts.create_if_missing    = true;
+        opts.recycle_log_file_num = 1;
+        opts.info_log_level       = rocksdb::FATAL_LEVEL;
+        opts.statistics           = _metrics.statistics();
+        std::unique_ptr<RetentionFilter> filter = retentionFilter(rocksdb::kDefaultColumnFamilyName, 1);
+        opts.compaction_filter                  = filter.get();
+        rocksdb::DB::Open(opts, path.string(), &_db);
+        if (_db)
+        {
+            addRetention(rocksdb::kDefaultColumnFamilyName, _db->DefaultColumnFamily(), std::move(filter));
+        }
+    }
+
+    /**
+     * @brief Has to be set before create() and the creation of the column families it covers, their compaction filters
+     * are installed when they are created. See expire(). Retention on the records needs the time index column.
+     * @throw std::invalid_argument for a column family without retention support, e.g. "desc" or a chunked column
+     */
+    void setRetention(const RetentionPolicy &policy)
+    {
+        for (const auto &it : policy.maxAge)
+        {
+            if (it.first != rocksdb::kDefaultColumnFamilyName && it.first != timeIndexColumn && 0 == rollupWidth(it.first))
+            {
+                throw std::invalid_argument("Retention is not supported for column " + it.first);
+            }
+        }
+        _retention = policy;
+    }
+
+    /**
+     * @brief Moves the cutoff of every column family with a maximum age to now - maxAge. Compactions drop what is
+     * older from then on; the records expire up to the first one in the time index that is not older.
+     * With RetentionPolicy::deleteFiles the table files completely below the cutoff are deleted right away.
+     */
+    void expire(uint64_t now)
+    {
+        if (_retentionColumns.count(rocksdb::kDefaultColumnFamilyName) && !_timeIndexHandle)
+        {
+            throw std::invalid_argument("Retention on the records requires the time index column");
+        }
+        for (auto &[column, retention] : _retentionColumns)
+        {
+            const uint64_t cutoff = now > retention.maxAge ? now - retention.maxAge : 0;
+            retention.filter->setCutoff(column == rocksdb::kDefaultColumnFamilyName ? firstIndexAfter(cutoff) : cutoff);
+            if (_retention.deleteFiles)
+            {
+                const IndexKey end = retention.filter->cutoffKey();
+                const rocksdb::Slice endSlice(toSlice(end));
+                rocksdb::Status status = rocksdb::DeleteFilesInRange(_db, retention.handle, nullptr, &endSlice, false);
+                if (!status.ok())
+                {
+                    throw std::invalid_argument(status.ToString());
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Compacts the expired key ranges now instead of waiting for the regular compactions.
+     */
+    void compactExpired()
+    {
+        for (auto &it : _retentionColumns)
+        {
+            const IndexKey end = it.second.filter->cutoffKey();
+            const rocksdb::Slice endSlice(toSlice(end));
+            rocksdb::Status status = _db->CompactRange(rocksdb::CompactRangeOptions(), it.second.handle, nullptr, &endSlice);
+            if (!status.ok())
+            {
+                throw std::invalid_argument(status.ToString());
+            }
+        }
+    }
+
+    void createNewColumn(const char *name)
+    {
+        _db->CreateColumnFamily(rocksdb::ColumnFamilyOptions(), name, &_descHandle);
+    }
+
+    /**
+     * @brief Creates the optional time index column, maintained by the writeMsg/appendMsg overloads taking a timestamp.
+     */
+    void createTimeIndexColumn()
+    {
+        std::unique_ptr<RetentionFilter> filter = retentionFilter(timeIndexColumn, 1);
+        rocksdb::ColumnFamilyOptions options;
+        options.compaction_filter = filter.get();
+        rocksdb::Status status    = _db->CreateColumnFamily(options, timeIndexColumn, &_timeIndexHandle);
+        if (!status.ok())
+        {
+            throw std::invalid_argument(status.ToString());
+        }
+        addRetention(timeIndexColumn, _timeIndexHandle, std::move(filter));
+    }
+
+    /**
+     * @brief Creates one rollup column family per bucket width, maintained by the writeMsg/appendMsg overloads taking
+     * a timestamp. All timestamped records have to be of the same message type, see rollup.h.
+     */
+    void createRollupColumns(const RollupOptions &options = RollupOptions())
+    {
+        for (uint64_t width : options.widths)
+        {
+            if (0 == width)
+            {
+                throw std::invalid_argument("Invalid rollup width 0");
+            }
+            std::unique_ptr<RetentionFilter> filter = retentionFilter(rollupColumn(width), width);
+            rocksdb::ColumnFamilyOptions options    = rollupOptions();
+            options.compaction_filter               = filter.get();
+            rocksdb::ColumnFamilyHandle *handle     = nullptr;
+            rocksdb::Status status                  = _db->CreateColumnFamily(options, rollupColumn(width), &handle);
+            if (!status.ok())
+            {
+                throw std::invalid_argument(status.ToString());
+            }
+            _rollupHandles.emplace_back(width, handle);
+            addRetention(rollupColumn(width), handle, std::move(filter));
+        }
+    }
+
+    /**
+     * @brief Creates the column family for records of registered schemas, see registerSchema and writeTypedMsg.
+     */
+    void createTypedColumn()
+    {
+        rocksdb::Status status = _db->CreateColumnFamily(typedRecordOptions(), typedRecordColumn, &_typedHandle);
+        if (!status.ok())
+        {
+            throw std::invalid_argument(status.ToString());
+        }
+    }
+
+    /**
+     * @brief Adds the message type of the schema text to the SchemaRegistry in the desc column.
+     * @return id of the schema, the known one if the message type is already registered with the same schema
+     */
+    uint32_t registerSchema(const char *text, const char *messageType)
+    {
+        if (!_descHandle)
+        {
+            throw std::invalid_argument("Desc column not created");
+        }
+        std::shared_ptr<const CompiledSchema> schema = SchemaCache::instance().fromText(text);
+        if (!schema->findMessageType(messageType))
+        {
+            throw std::invalid_argument(std::string("Message type ") + messageType + " not found in schema");
+        }
+        const RegisteredSchema *latest = _registry.find(messageType);
+        if (latest && latest->schema->fileDescriptorProto() == schema->fileDescriptorProto())
+        {
+            return latest->id;
+        }
+        msgDesc entry;
+        entry.set_measdescription(text);
+        entry.set_measdescriptorproto(schema->fileDescriptorProto());
+        entry.set_messagetype(messageType);
+        entry.set_schemaid(_registry.nextId());
+        std::string output;
+        entry.SerializeToString(&output);
+        rocksdb::WriteOptions options;
+        options.disableWAL     = _batchOptions.disableWAL;
+        rocksdb::Status status = _db->Put(options, _descHandle, SchemaRegistry::key(entry.schemaid()), output);
+        if (!status.ok())
+        {
+            throw std::invalid_argument(status.ToString());
+        }
+        return _registry.add(entry).id;
+    }
+
+    const SchemaRegistry &schemas() const
+    {
+        return _registry;
+    }
+
+    /**
+     * @brief Creates a column family storing chunkSize consecutive records per value instead of one, see appendChunkedMsg.
+     * The chunk size is a property of the writer only, readers find the chunk of a record without knowing it.
+     * With ChunkEncoding::Columns the numeric fields are delta/XOR coded per chunk, see ColumnChunkCodec.
+     * @throw std::invalid_argument for the reserved names, e.g. "desc", timeIndexColumn, typedRecordColumn or rollup columns
+     */
+    void createChunkedColumn(const char *name, uint64_t chunkSize, ChunkEncoding encoding = ChunkEncoding::Records)
+    {
+        if (reservedColumn(name))
+        {
+            throw std::invalid_argument(std::string("Column name ") + name + " is reserved");
+        }
+        if (0 == chunkSize || chunkSize > UINT32_MAX)
+        {
+            throw std::invalid_argument("Invalid chunk size " + std::to_string(chunkSize));
+        }
+        ChunkedColumn column;
+        column.chunkSize       = chunkSize;
+        column.encoding        = encoding;
+        rocksdb::Status status = _db->CreateColumnFamily(rocksdb::ColumnFamilyOptions(), name, &column.handle);
+        if (!status.ok())
+        {
+            throw std::invalid_argument(status.ToString());
+        }
+        _chunkedColumns.emplace(name, std::move(column));
+    }
+
+    /**
+     * @brief Stores the measurement description. If only the schema text is set, the compiled
+     * FileDescriptorProto is stored alongside, so readers don't have to parse the text again.
+     */
+    void writeDesc(const char *key, const msgDesc &desc)
+    {
+        std::string output;
+        serializeDesc(desc, output);
+        rocksdb::WriteOptions options;
+        options.disableWAL     = _batchOptions.disableWAL;
+        rocksdb::Status status = _db->Put(options, _descHandle, key, output);
+        if (!status.ok())
+        {
+            throw std::invalid_argument(status.ToString());
+        }
+    }
+
+    void writeMsg(uint64_t index, const google::protobuf::Message *msg)
+    {
+        std::string output;
+        serialize(msg, output);
+        rocksdb::WriteOptions options;
+        options.disableWAL = _batchOptions.disableWAL;
+        rocksdb::Status status;
+        {
+            DBMetrics::Timer timer(_metrics, DBOperation::Put);
+            status = _db->Put(options, toSlice(encodeIndexKey(index)), output);
+        }
+        if (_cache)
+        {
+            _cache->invalidate(index);
+        }
+        if (!status.ok())
+        {
+            throw std::invalid_argument(status.ToString());
+        }
+    }
+
+    /**
+     * @brief Writes the record, its time index entry and its rollup operands in one atomic WriteBatch.
+     */
+    void writeMsg(uint64_t index, uint64_t timestamp, const google::protobuf::Message *msg)
+    {
+        std::string output;
+        serialize(msg, output);
+        rocksdb::WriteBatch batch;
+        batch.Put(toSlice(encodeIndexKey(index)), output);
+        batch.Put(timeIndexHandle(), toSlice(encodeTimeIndexKey(timestamp, index)), rocksdb::Slice());
+        if (encodeRollup(msg, output))
+        {
+            mergeRollups(batch, timestamp);
+        }
+        rocksdb::WriteOptions options;
+        options.disableWAL = _batchOptions.disableWAL;
+        rocksdb::Status status = write(options, &batch);
+        if (_cache)
+        {
+            _cache->invalidate(index);
+        }
+        if (!status.ok())
+        {
+            throw std::invalid_argument(status.ToString());
+        }
+    }
+
+    /**
+     * @brief Writes msg as record index of the registered schema into the typed record column.
+     */
+    void writeTypedMsg(uint32_t schemaId, uint64_t index, const google::protobuf::Message *msg)
+    {
+        rocksdb::ColumnFamilyHandle *handle = typedHandle(schemaId, msg);
+        std::string output;
+        serialize(msg, output);
+        rocksdb::WriteOptions options;
+        options.disableWAL = _batchOptions.disableWAL;
+        DBMetrics::Timer timer(_metrics, DBOperation::Put);
+        rocksdb::Status status = _db->Put(options, handle, toSlice(encodeTypedKey(schemaId, index)), output);
+        if (!status.ok())
+        {
+            throw std::invalid_argument(status.ToString());
+        }
+    }
+
+    void setBatchOptions(const BatchOptions &options)
+    {
+        _batchOptions = options;
+    }
+
+    /**
+     * @brief Queues a message for the next group commit instead of writing it directly.
+     * The message is serialized into a reused buffer, the batch is committed once a threshold of
+     * BatchOptions is reached. Until then the record is not visible to readers.
+     */
+    void appendMsg(uint64_t index, const google::protobuf::Message *msg)
+    {
+        appendRecord(index, msg);
+        flushIfDue();
+    }
+
+    /**
+     * @brief Like appendMsg above, the time index entry and the rollup operands are committed in the same batch as the record.
+     */
+    void appendMsg(uint64_t index, uint64_t timestamp, const google::protobuf::Message *msg)
+    {
+        rocksdb::ColumnFamilyHandle *handle = timeIndexHandle();
+        serialize(msg, _buffer);
+        // a record of the wrong type is refused before the pending batch holds any part of it
+        const bool rollup = encodeRollup(msg, _buffer);
+        appendSerialized(index);
+        _batch.Put(handle, toSlice(encodeTimeIndexKey(timestamp, index)), rocksdb::Slice());
+        if (rollup)
+        {
+            mergeRollups(_batch, timestamp);
+        }
+        flushIfDue();
+    }
+
+    /**
+     * @brief writeTypedMsg through the group commit of appendMsg.
+     */
+    void appendTypedMsg(uint32_t schemaId, uint64_t index, const google::protobuf::Message *msg)
+    {
+        rocksdb::ColumnFamilyHandle *handle = typedHandle(schemaId, msg);
+        if (0 == _pendingMsgs)
+        {
+            _batchStart = std::chrono::steady_clock::now();
+        }
+        serialize(msg, _buffer);
+        _batch.Put(handle, toSlice(encodeTypedKey(schemaId, index)), _buffer);
+        ++_pendingMsgs;
+        flushIfDue();
+    }
+
+    /**
+     * @brief Adds the message to the open chunk of the column. Indices have to be ascending per column.
+     * A chunk is put into the pending batch once a record of the next chunk arrives; flush() also writes
+     * the partially filled chunk, which is rewritten when further records of it are appended.
+     */
+    void appendChunkedMsg(const char *column, uint64_t index, const google::protobuf::Message *msg)
+    {
+        ChunkedColumn &chunked = chunkedColumn(column);
+        if (!chunked.desc)
+        {
+            chunked.desc = msg->GetDescriptor();
+            if (chunked.encoding == ChunkEncoding::Columns)
+            {
+                chunked.builder.useColumns(chunked.desc);
+            }
+        }
+        else if (chunked.encoding == ChunkEncoding::Columns && chunked.desc->full_name() != msg->GetDescriptor()->full_name())
+        {
+            throw std::invalid_argument(std::string("Column coded chunks of ") + column + " hold " + chunked.desc->full_name() + " records");
+        }
+        const uint64_t start = index - index % chunked.chunkSize;
+        if (chunked.builder.empty() || start != chunked.builder.start())
+        {
+            if (!chunked.builder.empty() && start < chunked.builder.start())
+            {
+                throw std::invalid_argument("Chunked records have to be appended in ascending index order");
+            }
+            putChunk(chunked);
+            chunked.builder.reset(start);
+        }
+        if (0 == _pendingMsgs)
+        {
+            _batchStart = std::chrono::steady_clock::now();
+        }
+        serialize(msg, _buffer);
+        chunked.builder.add(index, _buffer);
+        chunked.dirty = true;
+        ++_pendingMsgs;
+        flushIfDue();
+    }
+
+    /**
+     * @brief Typed read/write access to the column family of KeyCodec for the generated message type Msg.
+     * Its writes bypass the batch of appendMsg, the record cache and the metrics.
+     */
+    template <typename Msg, typename KeyCodec>
+    TypedStore<Msg, KeyCodec> typedStore() const
+    {
+        return TypedStore<Msg, KeyCodec>(_db, _db ? columnHandle(KeyCodec::column) : nullptr, _batchOptions.disableWAL);
+    }
+
+    size_t pendingMsgs() const
+    {
+        return _pendingMsgs;
+    }
+
+    /**
+     * @brief Invalidates the cached records of the indices this creator writes, once they are committed.
+     * Share the cache with the DBReaders using it; nullptr detaches it.
+     */
+    void setRecordCache(std::shared_ptr<RecordCache> cache)
+    {
+        // atomic, the writer threads of an IngestPipeline load it concurrently
+        std::atomic_store(&_cache, std::move(cache));
+        _pendingIndices.clear();
+    }
+
+    /**
+     * @brief Serialize and put latencies of the writes, see DBMetrics. Statistics have to be enabled before create().
+     */
+    DBMetrics &metrics()
+    {
+        return _metrics;
+    }
+
+    void flush()
+    {
+        putChunks();
+        if (0 == _batch.Count())
+        {
+            return;
+        }
+        rocksdb::WriteOptions options;
+        options.disableWAL     = _batchOptions.disableWAL;
+        rocksdb::Status status = write(options, &_batch);
+        _batch.Clear();
+        _pendingMsgs = 0;
+        // also after a failed write, the batch may have been applied partially
+        invalidatePending();
+        if (!status.ok())
+        {
+            throw std::invalid_argument(status.ToString());
+        }
+    }
+};
@@ -0,0 +1,384 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <rocksdb/iostats_context.h>
+#include <rocksdb/perf_context.h>
+#include <rocksdb/perf_level.h>
+#include <rocksdb/statistics.h>
+
+#include "bitOps.h"
+
+/**
+ * @brief Operations timed by DBCreator and DBReader. Put covers single puts as well as batch commits.
+ */
+enum class DBOperation : uint8_t
+{
+    Serialize = 0,
+    Put,
+    Get,
+    Parse
+};
+
+constexpr size_t dbOperationCount = 4;
+
+inline const char *dbOperationName(DBOperation operation)
+{
+    constexpr std::array<const char *, dbOperationCount> names{"serialize", "put", "get", "parse"};
+    return names[static_cast<size_t>(operation)];
+}
+
+struct LatencySummary
+{
+    uint64_t count     = 0;
+    uint64_t sumNanos  = 0;
+    uint64_t minNanos  = 0;
+    uint64_t maxNanos  = 0;
+    uint64_t p50Nanos  = 0;
+    uint64_t p99Nanos  = 0;
+    uint64_t p999Nanos = 0;
+};
+
+/**
+ * @brief Lock free latency histogram in nanoseconds. Each power of two is split into four buckets,
+ * so percentiles are off by at most a quarter of the value. Concurrent record() calls only do relaxed
+ * atomic increments; a summary taken meanwhile may miss the latest samples, but never sees torn counters.
+ */
+class LatencyHistogram
+{
+private:
+    static constexpr size_t bucketCount = 252;
+
+    std::array<std::atomic<uint64_t>, bucketCount> _buckets{};
+    std::atomic<uint64_t> _sum{0};
+    std::atomic<uint64_t> _min{std::numeric_limits<uint64_t>::max()};
+    std::atomic<uint64_t> _max{0};
+
+    static size_t bucketOf(uint64_t nanos)
+    {
+        if (nanos < 4)
+        {
+            return static_cast<size_t>(nanos);
+        }
+        const int msb = 63 - countLeadingZeros(nanos);
+        return static_cast<size_t>(4 * (msb - 1) + ((nanos >> (msb - 2)) & 3));
+    }
+
+    static uint64_t bucketEnd(size_t bucket)
+    {
+        if (bucket < 4)
+        {
+            return bucket;
+        }
+        // last value of the bucket
+        const int msb = static_cast<int>(bucket / 4) + 1;
+        return ((uint64_t(4 + bucket % 4) + 1) << (msb - 2)) - 1;
+    }
+
+public:
+    void record(uint64_t nanos)
+    {
+        _buckets[bucketOf(nanos)].fetch_add(1, std::memory_order_relaxed);
+        _sum.fetch_add(nanos, std::memory_order_relaxed);
+        uint64_t current = _min.load(std::memory_order_relaxed);
+        while (nanos < current && !_min.compare_exchange_weak(current, nanos, std::memory_order_relaxed))
+        {
+        }
+        current = _max.load(std::memory_order_relaxed);
+        while (nanos > current && !_max.compare_exchange_weak(current, nanos, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    /**
+     * @brief Not atomic as a whole, samples recorded while resetting may survive partially.
+     */
+    void reset()
+    {
+        for (auto &bucket : _buckets)
+        {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+        _sum.store(0, std::memory_order_relaxed);
+        _min.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+        _max.store(0, std::memory_order_relaxed);
+    }
+
+    LatencySummary summary() const
+    {
+        std::array<uint64_t, bucketCount> buckets;
+        uint64_t count = 0;
+        for (size_t bucket = 0; bucket < bucketCount; ++bucket)
+        {
+            buckets[bucket]  = _buckets[bucket].load(std::memory_order_relaxed);
+            count           += buckets[bucket];
+        }
+        LatencySummary summary;
+        if (0 == count)
+        {
+            return summary;
+        }
+        summary.count    = count;
+        summary.sumNanos = _sum.load(std::memory_order_relaxed);
+        summary.minNanos = _min.load(std::memory_order_relaxed);
+        summary.maxNanos = _max.load(std::memory_order_relaxed);
+
+        auto percentile = [&](uint64_t permille) {
+            // rank of the sample, 1 based and rounded up
+            const uint64_t rank = std::max<uint64_t>(1, (count * permille + 999) / 1000);
+            uint64_t seen       = 0;
+            for (size_t bucket = 0; bucket < bucketCount; ++bucket)
+            {
+                seen += buckets[bucket];
+                if (seen >= rank)
+                {
+                    return std::min(bucketEnd(bucket), summary.maxNanos);
+                }
+            }
+            return summary.maxNanos;
+        };
+        summary.p50Nanos  = percentile(500);
+        summary.p99Nanos  = percentile(990);
+        summary.p999Nanos = percentile(999);
+        return summary;
+    }
+};
+
+/**
+ * @brief PerfContext and IOStatsContext counters of one thread, see DBMetrics::capturePerfContext.
+ */
+struct PerfCounters
+{
+    uint64_t keyComparisons     = 0;
+    uint64_t blockCacheHits     = 0;
+    uint64_t blockReads         = 0;
+    uint64_t blockReadBytes     = 0;
+    uint64_t blockReadNanos     = 0;
+    uint64_t memtableGetNanos   = 0;
+    uint64_t walWriteNanos      = 0;
+    uint64_t memtableWriteNanos = 0;
+    uint64_t writeDelayNanos    = 0;
+    uint64_t ioBytesRead        = 0;
+    uint64_t ioBytesWritten     = 0;
+    uint64_t ioReadNanos        = 0;
+    uint64_t ioWriteNanos       = 0;
+    uint64_t ioFsyncNanos       = 0;
+};
+
+struct MetricsSnapshot
+{
+    std::array<LatencySummary, dbOperationCount> latencies;
+    // filled if DBMetrics::enableStatistics was called before opening
+    std::vector<std::pair<std::string, uint64_t>> tickers;
+    std::vector<std::pair<std::string, rocksdb::HistogramData>> histograms;
+    // counters of the thread taking the snapshot, if it captures them
+    bool perfCaptured = false;
+    PerfCounters perf;
+
+    const LatencySummary &latency(DBOperation operation) const
+    {
+        return latencies[static_cast<size_t>(operation)];
+    }
+
+    std::string toJson() const
+    {
+        std::ostringstream out;
+        out << "{\"latencies\":{";
+        for (size_t op = 0; op < dbOperationCount; ++op)
+        {
+            const LatencySummary &lat = latencies[op];
+            out << (op ? "," : "") << '"' << dbOperationName(static_cast<DBOperation>(op)) << "\":{\"count\":" << lat.count
+                << ",\"sum_ns\":" << lat.sumNanos << ",\"min_ns\":" << lat.minNanos << ",\"max_ns\":" << lat.maxNanos
+                << ",\"p50_ns\":" << lat.p50Nanos << ",\"p99_ns\":" << lat.p99Nanos << ",\"p999_ns\":" << lat.p999Nanos << '}';
+        }
+        out << "},\"tickers\":{";
+        for (size_t pos = 0; pos < tickers.size(); ++pos)
+        {
+            out << (pos ? "," : "") << '"' << tickers[pos].first << "\":" << tickers[pos].second;
+        }
+        out << "},\"histograms\":{";
+        for (size_t pos = 0; pos < histograms.size(); ++pos)
+        {
+            const rocksdb::HistogramData &data = histograms[pos].second;
+            out << (pos ? "," : "") << '"' << histograms[pos].first << "\":{\"count\":" << data.count << ",\"average\":" << data.average
+                << ",\"median\":" << data.median << ",\"p99\":" << data.percentile99 << ",\"max\":" << data.max << '}';
+        }
+        out << '}';
+        if (perfCaptured)
+        {
+            out << ",\"perf\":{\"key_comparisons\":" << perf.keyComparisons << ",\"block_cache_hits\":" << perf.blockCacheHits
+                << ",\"block_reads\":" << perf.blockReads << ",\"block_read_bytes\":" << perf.blockReadBytes
+                << ",\"block_read_ns\":" << perf.blockReadNanos << ",\"memtable_get_ns\":" << perf.memtableGetNanos
+                << ",\"wal_write_ns\":" << perf.walWriteNanos << ",\"memtable_write_ns\":" << perf.memtableWriteNanos
+                << ",\"write_delay_ns\":" << perf.writeDelayNanos << ",\"io_bytes_read\":" << perf.ioBytesRead
+                << ",\"io_bytes_written\":" << perf.ioBytesWritten << ",\"io_read_ns\":" << perf.ioReadNanos
+                << ",\"io_write_ns\":" << perf.ioWriteNanos << ",\"io_fsync_ns\":" << perf.ioFsyncNanos << '}';
+        }
+        out << '}';
+        return out.str();
+    }
+};
+
+/**
+ * @brief Instrumentation of a DBCreator or DBReader, everything is off by default.
+ * - setEnabled: latency histograms per DBOperation. When off, an operation costs one relaxed atomic load.
+ * - enableStatistics: rocksdb::Statistics of the database, has to be called before create/Open.
+ * - capturePerfContext: rocksdb PerfContext and IOStatsContext of the calling thread.
+ */
+class DBMetrics
+{
+private:
+    std::atomic<bool> _enabled{false};
+    std::array<LatencyHistogram, dbOperationCount> _histograms;
+    std::shared_ptr<rocksdb::Statistics> _statistics;
+
+public:
+    /**
+     * @brief Times a scope into the histogram of an operation, if the metrics are enabled when it starts.
+     */
+    class Timer
+    {
+    private:
+        LatencyHistogram *_histogram = nullptr;
+        std::chrono::steady_clock::time_point _start;
+
+    public:
+        Timer(DBMetrics &metrics, DBOperation operation)
+        {
+            if (metrics._enabled.load(std::memory_order_relaxed))
+            {
+                _histogram = &metrics._histograms[static_cast<size_t>(operation)];
+                _start     = std::chrono::steady_clock::now();
+            }
+        }
+
+        ~Timer()
+        {
+            if (_histogram)
+            {
+                _histogram->record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - _start).count());
+            }
+        }
+
+        Timer(const Timer &) = delete;
+        Timer &operator=(const Timer &) = delete;
+    };
+
+    void setEnabled(bool enabled)
+    {
+        _enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    bool enabled() const
+    {
+        return _enabled.load(std::memory_order_relaxed);
+    }
+
+    void enableStatistics(rocksdb::StatsLevel level = rocksdb::kExceptDetailedTimers)
+    {
+        if (!_statistics)
+        {
+            _statistics = rocksdb::CreateDBStatistics();
+        }
+        _statistics->set_stats_level(level);
+    }
+
+    /**
+     * @return statistics to pass into the rocksdb options, nullptr unless enabled
+     */
+    const std::shared_ptr<rocksdb::Statistics> &statistics() const
+    {
+        return _statistics;
+    }
+
+    /**
+     * @brief Switches PerfContext and IOStatsContext collection of the calling thread on or off; both are reset.
+     * The perf level is a thread local setting of rocksdb, so it applies to every database used by the thread.
+     */
+    static void capturePerfContext(bool enable)
+    {
+        rocksdb::SetPerfLevel(enable ? rocksdb::kEnableTimeExceptForMutex : rocksdb::kDisable);
+        rocksdb::get_perf_context()->Reset();
+        rocksdb::get_iostats_context()->Reset();
+    }
+
+    /**
+     * @brief Clears the histograms, the rocksdb statistics and the perf context of the calling thread.
+     */
+    void reset()
+    {
+        for (auto &histogram : _histograms)
+        {
+            histogram.reset();
+        }
+        if (_statistics)
+        {
+            _statistics->Reset();
+        }
+        rocksdb::get_perf_context()->Reset();
+        rocksdb::get_iostats_context()->Reset();
+    }
+
+    MetricsSnapshot snapshot() const
+    {
+        MetricsSnapshot snapshot;
+        for (size_t op = 0; op < dbOperationCount; ++op)
+        {
+            snapshot.latencies[op] = _histograms[op].summary();
+        }
+        if (_statistics)
+        {
+            constexpr std::pair<rocksdb::Tickers, const char *> tickers[] = {
+                {rocksdb::BLOCK_CACHE_MISS, "rocksdb.block.cache.miss"},
+                {rocksdb::BLOCK_CACHE_HIT, "rocksdb.block.cache.hit"},
+                {rocksdb::BYTES_WRITTEN, "rocksdb.bytes.written"},
+                {rocksdb::BYTES_READ, "rocksdb.bytes.read"},
+                {rocksdb::NUMBER_KEYS_WRITTEN, "rocksdb.number.keys.written"},
+                {rocksdb::NUMBER_KEYS_READ, "rocksdb.number.keys.read"},
+                {rocksdb::STALL_MICROS, "rocksdb.stall.micros"}};
+            for (const auto &ticker : tickers)
+            {
+                snapshot.tickers.emplace_back(ticker.second, _statistics->getTickerCount(ticker.first));
+            }
+            constexpr std::pair<rocksdb::Histograms, const char *> histograms[] = {{rocksdb::DB_GET, "rocksdb.db.get.micros"},
+                                                                                   {rocksdb::DB_WRITE, "rocksdb.db.write.micros"},
+                                                                                   {rocksdb::DB_MULTIGET, "rocksdb.db.multiget.micros"},
+                                                                                   {rocksdb::COMPACTION_TIME, "rocksdb.compaction.times.micros"}};
+            for (const auto &histogram : histograms)
+            {
+                snapshot.histograms.emplace_back(histogram.second, rocksdb::HistogramData());
+                _statistics->histogramData(histogram.first, &snapshot.histograms.back().second);
+            }
+        }
+        if (rocksdb::GetPerfLevel() > rocksdb::kDisable)
+        {
+            const rocksdb::PerfContext *perf      = rocksdb::get_perf_context();
+            const rocksdb::IOStatsContext *iostats = rocksdb::get_iostats_context();
+            snapshot.perfCaptured                  = true;
+            snapshot.perf.keyComparisons           = perf->user_key_comparison_count;
+            snapshot.perf.blockCacheHits           = perf->block_cache_hit_count;
+            snapshot.perf.blockReads               = perf->block_read_count;
+            snapshot.perf.blockReadBytes           = perf->block_read_byte;
+            snapshot.perf.blockReadNanos           = perf->block_read_time;
+            snapshot.perf.memtableGetNanos         = perf->get_from_memtable_time;
+            snapshot.perf.walWriteNanos            = perf->write_wal_time;
+            snapshot.perf.memtableWriteNanos       = perf->write_memtable_time;
+            snapshot.perf.writeDelayNanos          = perf->write_delay_time;
+            snapshot.perf.ioBytesRead              = iostats->bytes_read;
+            snapshot.perf.ioBytesWritten           = iostats->bytes_written;
+            snapshot.perf.ioReadNanos              = iostats->read_nanos;
+            snapshot.perf.ioWriteNanos             = iostats->write_nanos;
+            snapshot.perf.ioFsyncNanos             = iostats->fsync_nanos;
+        }
+        return snapshot;
+    }
+};
@@ -0,0 +1,1064 @@
+#pragma once
+
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <rocksdb/db.h>
+
+#include <google/protobuf/message.h>
+
+#include <desc.pb.h>
+
+#include "arenaBatch.h"
+#include "chunkFormat.h"
+#include "columnScan.h"
+#include "dbMetrics.h"
+#include "keyCodec.h"
+#include "recordCache.h"
+#include "rollup.h"
+#include "rowDecoder.h"
+#include "scanFilter.h"
+#include "schemaRegistry.h"
+#include "typedStore.h"
+#include "workerPool.h"
+
+/**
+ * @brief Holds a rocksdb snapshot for the lifetime of the guard.
+ */
+class SnapshotGuard
+{
+private:
+    rocksdb::DB *_db                   = nullptr;
+    const rocksdb::Snapshot *_snapshot = nullptr;
+
+public:
+    explicit SnapshotGuard(rocksdb::DB *db) : _db(db), _snapshot(db->GetSnapshot())
+    {
+    }
+
+    ~SnapshotGuard()
+    {
+        _db->ReleaseSnapshot(_snapshot);
+    }
+
+    SnapshotGuard(const SnapshotGuard &) = delete;
+    SnapshotGuard &operator=(const SnapshotGuard &) = delete;
+
+    const rocksdb::Snapshot *get() const
+    {
+        return _snapshot;
+    }
+};
+
+/**
+ * @brief Splits [startIndex, endIndex) into at most count adjoining sub ranges of about the same width.
+ */
+inline std::vector<std::pair<uint64_t, uint64_t>> splitIndexRange(uint64_t startIndex, uint64_t endIndex, size_t count)
+{
+    std::vector<std::pair<uint64_t, uint64_t>> ranges;
+    if (startIndex >= endIndex || 0 == count)
+    {
+        return ranges;
+    }
+    const uint64_t width = endIndex - startIndex;
+    const uint64_t parts = std::min<uint64_t>(count, width);
+    uint64_t begin       = startIndex;
+    for (uint64_t part = 1; part <= parts; ++part)
+    {
+        // the last part ends at endIndex, whatever the rounding
+        const uint64_t end = part == parts ? endIndex : startIndex + width / parts * part + std::min(part, width % parts);
+        ranges.emplace_back(begin, end);
+        begin = end;
+    }
+    return ranges;
+}
+
+class DBReader
+{
+private:
+    rocksdb::DB *_db = nullptr;
+    std::vector<rocksdb::ColumnFamilyHandle *> _vecHandle;
+    rocksdb::PinnableSlice _pinned;
+    ChunkView _chunk;
+    DBMetrics _metrics;
+    std::shared_ptr<RecordCache> _cache;
+    SchemaRegistry _registry;
+    bool _registryLoaded = false;
+
+    void parseFromSlice(const rocksdb::Slice &value, google::protobuf::Message *msg)
+    {
+        DBMetrics::Timer timer(_metrics, DBOperation::Parse);
+        if (!msg->ParseFromArray(value.data(), static_cast<int>(value.size())))
+        {
+            throw std::invalid_argument("Error while parsing");
+        }
+    }
+
+    /**
+     * @return Corruption if the value can't be parsed
+     */
+    rocksdb::Status tryReadInto(rocksdb::ColumnFamilyHandle *handle, const rocksdb::Slice &key, google::protobuf::Message *msg,
+                                rocksdb::PinnableSlice &pinned)
+    {
+        rocksdb::Status status;
+        {
+            DBMetrics::Timer timer(_metrics, DBOperation::Get);
+            status = _db->Get(rocksdb::ReadOptions(), handle, key, &pinned);
+        }
+        if (!status.ok())
+        {
+            return status;
+        }
+        bool parsed = false;
+        {
+            DBMetrics::Timer timer(_metrics, DBOperation::Parse);
+            parsed = msg->ParseFromArray(pinned.data(), static_cast<int>(pinned.size()));
+        }
+        pinned.Reset();
+        return parsed ? status : rocksdb::Status::Corruption("Error while parsing");
+    }
+
+    void readInto(rocksdb::ColumnFamilyHandle *handle, const rocksdb::Slice &key, google::protobuf::Message *msg)
+    {
+        rocksdb::Status status = tryReadInto(handle, key, msg, _pinned);
+        if (!status.ok())
+        {
+            throw std::invalid_argument(status.ToString());
+        }
+    }
+
+    void parseChunk(const rocksdb::Slice &value)
+    {
+        if (!_chunk.parse(value))
+        {
+            throw std::invalid_argument("Error while parsing chunk");
+        }
+    }
+
+    template <typename Callback>
+    size_t scanRange(const rocksdb::Snapshot *snapshot, uint64_t startIndex, uint64_t endIndex, Callback &&callback) const
+    {
+        const IndexKey startKey = encodeIndexKey(startIndex);
+        const IndexKey endKey   = encodeIndexKey(endIndex);
+        const rocksdb::Slice upperBound(toSlice(endKey));
+        rocksdb::ReadOptions options;
+        options.snapshot            = snapshot;
+        options.iterate_upper_bound = &upperBound;
+
+        size_t ctr = 0;
+        std::unique_ptr<rocksdb::Iterator> iter(_db->NewIterator(options));
+        for (iter->Seek(toSlice(startKey)); iter->Valid(); iter->Next())
+        {
+            callback(decodeIndexKey(iter->key()), iter->value());
+            ++ctr;
+        }
+        if (!iter->status().ok())
+        {
+            throw std::invalid_argument(iter->status().ToString());
+        }
+        return ctr;
+    }
+
+    /**
+     * @brief Scans the sub ranges on the pool, all on one snapshot, and calls done(pos, visited) after sub range pos.
+     * Waits for every task before rethrowing the first exception, as the tasks use the snapshot and the caller's state.
+     * @return number of visited records
+     */
+    template <typename Callback, typename Done>
+    size_t scanPartitions(const std::vector<std::pair<uint64_t, uint64_t>> &ranges, WorkerPool &pool, Callback &callback, Done &&done)
+    {
+        const SnapshotGuard snapshot(_db);
+        std::vector<std::future<size_t>> futures;
+        futures.reserve(ranges.size());
+        try
+        {
+            for (size_t pos = 0; pos < ranges.size(); ++pos)
+            {
+                futures.push_back(pool.submit([&, pos]() {
+                    const size_t visited = scanRange(snapshot.get(), ranges[pos].first, ranges[pos].second,
+                                                     [&](uint64_t index, const rocksdb::Slice &value) { callback(pos, index, value); });
+                    done(pos, visited);
+                    return visited;
+                }));
+            }
+        }
+        catch (...)
+        {
+            // the submitted tasks must not outlive the snapshot and the references
+            for (auto &future : futures)
+            {
+                future.wait();
+            }
+            throw;
+        }
+        size_t ctr = 0;
+        std::exception_ptr error;
+        for (auto &future : futures)
+        {
+            try
+            {
+                ctr += future.get();
+            }
+            catch (...)
+            {
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+        }
+        if (error)
+        {
+            std::rethrow_exception(error);
+        }
+        return ctr;
+    }
+
+    rocksdb::Options openOptions() const
+    {
+        rocksdb::Options options;
+        options.create_if_missing    = false;
+        options.info_log_level       = rocksdb::FATAL_LEVEL;
+        options.keep_log_file_num    = 1;
+        options.recycle_log_file_num = 1;
+        options.statistics           = _metrics.statistics();
+        return options;
+    }
+
+    /**
+     * @brief Descriptors of every column family found in the database
+     */
+    static std::vector<rocksdb::ColumnFamilyDescriptor> columnDescriptors(const rocksdb::Options &options, const std::filesystem::path &path)
+    {
+        std::vector<std::string> names;
+        rocksdb::Status status = rocksdb::DB::ListColumnFamilies(options, path.string(), &names);
+        if (!status.ok())
+        {
+            throw std::invalid_argument(status.ToString());
+        }
+        std::vector<rocksdb::ColumnFamilyDescriptor> vecOptions;
+        for (const std::string &name : names)
+        {
+            if (name == typedRecordColumn)
+            {
+                vecOptions.emplace_back(name, typedRecordOptions());
+            }
+            else
+            {
+                // the merge operands of the rollups are folded while reading
+                vecOptions.emplace_back(name, rollupWidth(name) ? rollupOptions() : rocksdb::ColumnFamilyOptions());
+            }
+        }
+        return vecOptions;
+    }
+
+    template <typename Callback>
+    size_t scanTyped(uint32_t schemaId, uint64_t startIndex, uint64_t endIndex, Callback &&callback)
+    {
+        const TypedKey startKey = encodeTypedKey(schemaId, startIndex);
+        const TypedKey endKey   = encodeTypedKey(schemaId, endIndex);
+        const rocksdb::Slice upperBound(toSlice(endKey));
+        rocksdb::ReadOptions options;
+        options.iterate_upper_bound = &upperBound;
+        // the seek only looks at memtables and files whose prefix bloom filter may hold the schema id
+        options.prefix_same_as_start = true;
+
+        size_t ctr = 0;
+        std::unique_ptr<rocksdb::Iterator> iter(_db->NewIterator(options, requireColumn(typedRecordColumn)));
+        for (iter->Seek(toSlice(startKey)); iter->Valid(); iter->Next())
+        {
+            callback(decodeTypedKey(iter->key()).second, iter->value());
+            ++ctr;
+        }
+        if (!iter->status().ok())
+        {
+            throw std::invalid_argument(iter->status().ToString());
+        }
+        return ctr;
+    }
+
+    rocksdb::ColumnFamilyHandle *requireColumn(const std::string &name) const
+    {
+        rocksdb::ColumnFamilyHandle *handle = columnHandle(name);
+        if (!handle)
+        {
+            throw std::invalid_argument("Column family " + name + " not found");
+        }
+        return handle;
+    }
+
+public:
+    ~DBReader()
+    {
+        if (_db)
+        {
+            for (auto &it : _vecHandle)
+            {
+                delete it;
+            }
+            _db->Close();
+            delete _db;
+        }
+    }
+
+    /**
+     * @brief Opens the database with all of its column families, optional ones like the time index included.
+     */
+    void Open(const std::filesystem::path &path)
+    {
+        const rocksdb::Options options = openOptions();
+        rocksdb::Status status         = rocksdb::DB::Open(options, path.string(), columnDescriptors(options, path), &_vecHandle, &_db);
+        if (!status.ok())
+        {
+            throw std::invalid_argument(status.ToString());
+        }
+    }
+
+    /**
+     * @brief Opens the database as secondary instance of a DBCreator that keeps writing. Unlike Open, which
+     * only sees what was written before, TryCatchUpWithPrimary makes newer records visible without reopening.
+     * The secondary keeps its own info log in secondaryPath, empty means "<path>.secondary".
+     */
+    void OpenAsSecondary(const std::filesystem::path &path, const std::filesystem::path &secondaryPath = std::filesystem::path())
+    {
+        const std::filesystem::path logPath = secondaryPath.empty() ? std::filesystem::path(path.string() + ".secondary") : secondaryPath;
+        rocksdb::Options options            = openOptions();
+        // a secondary has to keep all table files open, it can't reopen files the primary deleted
+        options.max_open_files = -1;
+
+        rocksdb::Status status =
+            rocksdb::DB::OpenAsSecondary(options, path.string(), logPath.string(), columnDescriptors(options, path), &_vecHandle, &_db);
+        if (!status.ok())
+        {
+            throw std::invalid_argument(status.ToString());
+        }
+    }
+
+    /**
+     * @brief Replays what the primary wrote to its WAL and MANIFEST since the last call, only for OpenAsSecondary.
+     * Records written without WAL (the DBCreator default) only show up once the primary flushed them.
+     */
+    void TryCatchUpWithPrimary()
+    {
+        rocksdb::Status status = _db->TryCatchUpWithPrimary();
+        if (!status.ok())
+        {
+            throw std::invalid_argument(status.ToString());
+        }
+    }
+
+    /**
+     * @brief Get and parse latencies of the point reads and parse latencies of ReadRange with a message, see DBMetrics.
+     * Statistics have to be enabled before Open().
+     */
+    DBMetrics &metrics()
+    {
+        return _metrics;
+    }
+
+    /**
+     * @return handle of the column family or nullptr if the database has no such column family
+     */
+    rocksdb::ColumnFamilyHandle *columnHandle(const std::string &name) const
+    {
+        for (rocksdb::ColumnFamilyHandle *handle : _vecHandle)
+        {
+            if (handle->GetName() == name)
+            {
+                return handle;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Typed read access to the column family of KeyCodec for the generated message type Msg, see TypedStore.
+     */
+    template <typename Msg, typename KeyCodec>
+    TypedStore<Msg, KeyCodec> OpenTypedStore() const
+    {
+        return TypedStore<Msg, KeyCodec>(_db, _db ? columnHandle(KeyCodec::column) : nullptr);
+    }
+
+    msgDesc ReadDesc(const char *key)
+    {
+        msgDesc msg;
+        readInto(requireColumn("desc"), key, &msg);
+        return msg;
+    }
+
+    std::string ReadMsg(uint64_t index)
+    {
+        std::string value;
+        rocksdb::Status status = TryReadMsg(index, &value);
+        if (!status.ok())
+        {
+            throw std::invalid_argument(status.ToString());
+        }
+        return value;
+    }
+
+    /**
+     * @brief Non throwing variants of ReadMsg and ReadDesc, safe to call from several threads at once (see AsyncReader).
+     * A missing record is NotFound, a record that can't be parsed Corruption.
+     */
+    rocksdb::Status TryReadMsg(uint64_t index, std::string *value)
+    {
+        DBMetrics::Timer timer(_metrics, DBOperation::Get);
+        return _db->Get(rocksdb::ReadOptions(), toSlice(encodeIndexKey(index)), value);
+    }
+
+    rocksdb::Status TryReadMsg(uint64_t index, google::protobuf::Message *msg)
+    {
+        rocksdb::PinnableSlice pinned;
+        return tryReadInto(_db->DefaultColumnFamily(), toSlice(encodeIndexKey(index)), msg, pinned);
+    }
+
+    rocksdb::Status TryReadDesc(const std::string &key, msgDesc *msg)
+    {
+        rocksdb::ColumnFamilyHandle *handle = columnHandle("desc");
+        if (!handle)
+        {
+            return rocksdb::Status::InvalidArgument("Column family desc not found");
+        }
+        rocksdb::PinnableSlice pinned;
+        return tryReadInto(handle, key, msg, pinned);
+    }
+
+    /**
+     * @brief Parses the record straight from the value pinned by rocksdb into the caller owned msg.
+     * Unlike ReadMsg(index) the value is not copied into a std::string first.
+     */
+    void ReadMsg(uint64_t index, google::protobuf::Message *msg)
+    {
+        readInto(_db->DefaultColumnFamily(), toSlice(encodeIndexKey(index)), msg);
+    }
+
+    /**
+     * @brief Uses the cache for ReadCachedMsg, share it with the DBCreator writing the database so its writes invalidate it.
+     */
+    void setRecordCache(std::shared_ptr<RecordCache> cache)
+    {
+        _cache = std::move(cache);
+    }
+
+    /**
+     * @brief Record index as message of the prototype's type. A cache hit skips both the rocksdb lookup and the parse,
+     * a miss reads and parses the record and caches it. Without a cache it is always read.
+     * @return immutable message, possibly shared with other readers of the cache
+     */
+    std::shared_ptr<const google::protobuf::Message> ReadCachedMsg(uint64_t index, const google::protobuf::Message &prototype)
+    {
+        RecordCache::Ticket ticket = 0;
+        if (_cache)
+        {
+            std::shared_ptr<const google::protobuf::Message> cached = _cache->lookup(prototype.GetDescriptor(), index, ticket);
+            if (cached)
+            {
+                return cached;
+            }
+        }
+        std::shared_ptr<google::protobuf::Message> msg(prototype.New());
+        readInto(_db->DefaultColumnFamily(), toSlice(encodeIndexKey(index)), msg.get());
+        if (_cache)
+        {
+            _cache->insert(index, msg, ticket);
+        }
+        return msg;
+    }
+
+    /**
+     * @brief Batched point lookup of count records with one MultiGet instead of one Get per key.
+     * values[i] and statuses[i] belong to indices[i], a missing record is reported as NotFound status.
+     * The indices are sorted before the lookup, so MultiGet can share block cache lookups and file reads;
+     * already sorted input is passed through without a permutation.
+     */
+    void ReadMany(const uint64_t *indices, size_t count, rocksdb::PinnableSlice *values, rocksdb::Status *statuses)
+    {
+        std::vector<size_t> order(count);
+        std::iota(order.begin(), order.end(), 0);
+        const bool sorted = std::is_sorted(indices, indices + count);
+        if (!sorted)
+        {
+            std::sort(order.begin(), order.end(), [indices](size_t lhs, size_t rhs) { return indices[lhs] < indices[rhs]; });
+        }
+
+        std::vector<IndexKey> keys(count);
+        std::vector<rocksdb::Slice> slices(count);
+        for (size_t pos = 0; pos < count; ++pos)
+        {
+            keys[pos]   = encodeIndexKey(indices[order[pos]]);
+            slices[pos] = toSlice(keys[pos]);
+        }
+
+        for (size_t pos = 0; pos < count; ++pos)
+        {
+            values[pos].Reset();
+        }
+        if (sorted)
+        {
+            _db->MultiGet(rocksdb::ReadOptions(), _db->DefaultColumnFamily(), count, slices.data(), values, statuses, true);
+            return;
+        }
+        std::vector<rocksdb::PinnableSlice> sortedValues(count);
+        std::vector<rocksdb::Status> sortedStatuses(count);
+        _db->MultiGet(rocksdb::ReadOptions(), _db->DefaultColumnFamily(), count, slices.data(), sortedValues.data(), sortedStatuses.data(), true);
+        for (size_t pos = 0; pos < count; ++pos)
+        {
+            values[order[pos]]   = std::move(sortedValues[pos]);
+            statuses[order[pos]] = sortedStatuses[pos];
+        }
+    }
+
+    std::vector<rocksdb::Status> ReadMany(const std::vector<uint64_t> &indices, std::vector<rocksdb::PinnableSlice> &values)
+    {
+        std::vector<rocksdb::Status> statuses(indices.size());
+        values.resize(indices.size());
+        ReadMany(indices.data(), indices.size(), values.data(), statuses.data());
+        return statuses;
+    }
+
+    /**
+     * @brief Calls callback(index, value) for every record in [startIndex, endIndex) in ascending order.
+     * The range is walked with a single bounded iterator, missing indices are skipped.
+     * The value slice is only valid during the callback.
+     * @return number of visited records
+     */
+    template <typename Callback>
+    size_t ReadRange(uint64_t startIndex, uint64_t endIndex, Callback &&callback)
+    {
+        return scanRange(nullptr, startIndex, endIndex, callback);
+    }
+
+    /**
+     * @brief Like ReadRange above, but parses every record from the iterator's value into msg
+     * and calls callback(index, *msg).
+     */
+    template <typename Callback>
+    size_t ReadRange(uint64_t startIndex, uint64_t endIndex, google::protobuf::Message *msg, Callback &&callback)
+    {
+        return ReadRange(startIndex, endIndex, [this, msg, &callback](uint64_t index, const rocksdb::Slice &value) {
+            parseFromSlice(value, msg);
+            callback(index, *msg);
+        });
+    }
+
+    /**
+     * @brief Clears the batch and parses the records in [startIndex, endIndex) into messages on its arena.
+     * If parsing fails, the batch keeps the records up to the failing one.
+     * @return number of decoded records
+     */
+    size_t ReadBatch(uint64_t startIndex, uint64_t endIndex, ArenaBatch &batch)
+    {
+        batch.clear();
+        return ReadRange(startIndex, endIndex,
+                         [this, &batch](uint64_t index, const rocksdb::Slice &value) { parseFromSlice(value, batch.add(index)); });
+    }
+
+    /**
+     * @brief Parses the records in [startIndex, endIndex) in batches of up to batchSize records and calls callback(batch)
+     * for each of them. The arena is reset between the batches, so the messages are only valid during the callback.
+     * @return number of decoded records
+     */
+    template <typename Callback>
+    size_t ReadBatches(uint64_t startIndex, uint64_t endIndex, ArenaBatch &batch, size_t batchSize, Callback &&callback)
+    {
+        batch.clear();
+        const size_t ctr = ReadRange(startIndex, endIndex, [&](uint64_t index, const rocksdb::Slice &value) {
+            parseFromSlice(value, batch.add(index));
+            if (batch.size() >= batchSize)
+            {
+                callback(batch);
+                batch.clear();
+            }
+        });
+        if (!batch.empty())
+        {
+            callback(batch);
+            batch.clear();
+        }
+        return ctr;
+    }
+
+    /**
+     * @brief Decodes all records in [startIndex, endIndex) into one column per decoder slot.
+     * The columns are appended to, so a large range can be processed in several calls.
+     * @return number of appended records
+     */
+    template <typename T>
+    size_t ReadColumns(uint64_t startIndex, uint64_t endIndex, RowDecoder &decoder, ColumnBatch<T> &batch)
+    {
+        batch.columns.resize(decoder.size());
+        std::vector<T> row(decoder.size());
+        return ReadRange(startIndex, endIndex, [&](uint64_t index, const rocksdb::Slice &value) {
+            if (!decoder.decode(value.data(), value.size(), row.data()))
+            {
+                throw std::invalid_argument("Error while parsing");
+            }
+            batch.indices.push_back(index);
+            for (size_t slot = 0; slot < row.size(); ++slot)
+            {
+                batch.columns[slot].push_back(row[slot]);
+            }
+        });
+    }
+
+    /**
+     * @brief ReadRange with predicate pushdown: calls callback(index, value) only for the records in
+     * [startIndex, endIndex) matching the filter, which is evaluated on the wire bytes without parsing.
+     * @return number of matching records
+     */
+    template <typename Callback>
+    size_t ReadRangeFiltered(uint64_t startIndex, uint64_t endIndex, const ScanFilter &filter, Callback &&callback)
+    {
+        size_t ctr = 0;
+        ReadRange(startIndex, endIndex, [&](uint64_t index, const rocksdb::Slice &value) {
+            if (filter.matches(value.data(), value.size()))
+            {
+                ++ctr;
+                callback(index, value);
+            }
+        });
+        return ctr;
+    }
+
+    /**
+     * @brief Like ReadRangeFiltered above, but parses the matching records into msg and calls callback(index, *msg).
+     * Records rejected by the filter are never parsed.
+     */
+    template <typename Callback>
+    size_t ReadRangeFiltered(uint64_t startIndex, uint64_t endIndex, const ScanFilter &filter, google::protobuf::Message *msg, Callback &&callback)
+    {
+        return ReadRangeFiltered(startIndex, endIndex, filter, [this, msg, &callback](uint64_t index, const rocksdb::Slice &value) {
+            parseFromSlice(value, msg);
+            callback(index, *msg);
+        });
+    }
+
+    /**
+     * @brief Parallel ReadRange: [startIndex, endIndex) is split into up to partitions sub ranges, which are scanned
+     * on the pool with bounded iterators on one snapshot. Every sub range gets its own partial result from
+     * makePartial(), callback(partial, index, value) fills it from the records of the sub range in ascending order.
+     * The callback runs concurrently for different sub ranges and must only touch its partial.
+     * @return the partials in key order, so the caller merges them in order
+     */
+    template <typename MakePartial, typename Callback>
+    std::vector<std::invoke_result_t<MakePartial>> ReadRangeParallel(uint64_t startIndex, uint64_t endIndex, WorkerPool &pool, size_t partitions,
+                                                                     MakePartial &&makePartial, Callback &&callback)
+    {
+        const auto ranges = splitIndexRange(startIndex, endIndex, partitions);
+        std::vector<std::invoke_result_t<MakePartial>> partials;
+        partials.reserve(ranges.size());
+        for (size_t pos = 0; pos < ranges.size(); ++pos)
+        {
+            partials.push_back(makePartial());
+        }
+        auto scan = [&](size_t pos, uint64_t index, const rocksdb::Slice &value) { callback(partials[pos], index, value); };
+        scanPartitions(ranges, pool, scan, [](size_t, size_t) {});
+        return partials;
+    }
+
+    /**
+     * @brief Like ReadRangeParallel above, but every partial is handed to reducer(std::move(partial)) as soon as
+     * its sub range is done, in no particular order. The reducer calls are serialized.
+     * @return number of visited records
+     */
+    template <typename MakePartial, typename Callback, typename Reducer>
+    size_t ReadRangeParallel(uint64_t startIndex, uint64_t endIndex, WorkerPool &pool, size_t partitions, MakePartial &&makePartial,
+                             Callback &&callback, Reducer &&reducer)
+    {
+        const auto ranges = splitIndexRange(startIndex, endIndex, partitions);
+        std::vector<std::invoke_result_t<MakePartial>> partials;
+        partials.reserve(ranges.size());
+        for (size_t pos = 0; pos < ranges.size(); ++pos)
+        {
+            partials.push_back(makePartial());
+        }
+        std::mutex reducerMtx;
+        auto scan = [&](size_t pos, uint64_t index, const rocksdb::Slice &value) { callback(partials[pos], index, value); };
+        return scanPartitions(ranges, pool, scan, [&](size_t pos, size_t) {
+            std::lock_guard<std::mutex> lock(reducerMtx);
+            reducer(std::move(partials[pos]));
+        });
+    }
+
+    template <typename MakePartial, typename Callback>
+    std::vector<std::invoke_result_t<MakePartial>> ReadRangeParallel(const msgDesc &desc, WorkerPool &pool, size_t partitions, MakePartial &&makePartial,
+                                                                     Callback &&callback)
+    {
+        return ReadRangeParallel(desc.startindex(), desc.endindex(), pool, partitions, std::forward<MakePartial>(makePartial),
+                                 std::forward<Callback>(callback));
+    }
+
+    template <typename MakePartial, typename Callback, typename Reducer>
+    size_t ReadRangeParallel(const msgDesc &desc, WorkerPool &pool, size_t partitions, MakePartial &&makePartial, Callback &&callback,
+                             Reducer &&reducer)
+    {
+        return ReadRangeParallel(desc.startindex(), desc.endindex(), pool, partitions, std::forward<MakePartial>(makePartial),
+                                 std::forward<Callback>(callback), std::forward<Reducer>(reducer));
+    }
+
+    /**
+     * @brief Parallel ReadColumns, every sub range is decoded with its own RowDecoder of prototype.
+     * The partial batches are appended to batch in key order.
+     * @return number of appended records
+     */
+    template <typename T>
+    size_t ReadColumnsParallel(uint64_t startIndex, uint64_t endIndex, WorkerPool &pool, size_t partitions, const google::protobuf::Message &prototype,
+                               ColumnBatch<T> &batch)
+    {
+        struct Partial
+        {
+            RowDecoder decoder;
+            ColumnBatch<T> batch;
+            std::vector<T> row;
+        };
+        auto partials = ReadRangeParallel(
+            startIndex, endIndex, pool, partitions,
+            [&prototype]() {
+                Partial partial{RowDecoder(prototype), ColumnBatch<T>(), std::vector<T>()};
+                partial.batch.columns.resize(partial.decoder.size());
+                partial.row.resize(partial.decoder.size());
+                return partial;
+            },
+            [](Partial &partial, uint64_t index, const rocksdb::Slice &value) {
+                if (!partial.decoder.decode(value.data(), value.size(), partial.row.data()))
+                {
+                    throw std::invalid_argument("Error while parsing");
+                }
+                partial.batch.indices.push_back(index);
+                for (size_t slot = 0; slot < partial.row.size(); ++slot)
+                {
+                    partial.batch.columns[slot].push_back(partial.row[slot]);
+                }
+            });
+
+        size_t ctr = 0;
+        for (Partial &partial : partials)
+        {
+            batch.columns.resize(partial.batch.columns.size());
+            batch.indices.insert(batch.indices.end(), partial.batch.indices.begin(), partial.batch.indices.end());
+            for (size_t slot = 0; slot < partial.batch.columns.size(); ++slot)
+            {
+                batch.columns[slot].insert(batch.columns[slot].end(), partial.batch.columns[slot].begin(), partial.batch.columns[slot].end());
+            }
+            ctr += partial.batch.size();
+        }
+        return ctr;
+    }
+
+    /**
+     * @brief Calls callback(index, timestamp, value) for every record with a timestamp in [startTime, endTime),
+     * ordered by timestamp. Needs the time index written by DBCreator. Index and records are read
+     * from the same snapshot; as timestamps usually grow with the index, the record iterator mostly
+     * just steps forward instead of seeking.
+     * @return number of visited records
+     */
+    template <typename Callback>
+    size_t ReadTimeRange(uint64_t startTime, uint64_t endTime, Callback &&callback)
+    {
+        rocksdb::ColumnFamilyHandle *indexHandle = requireColumn(timeIndexColumn);
+        const TimeIndexKey startKey              = encodeTimeIndexKey(startTime, 0);
+        const TimeIndexKey endKey                = encodeTimeIndexKey(endTime, 0);
+        const rocksdb::Slice upperBound(toSlice(endKey));
+
+        const SnapshotGuard snapshot(_db);
+        rocksdb::ReadOptions indexOptions;
+        indexOptions.snapshot            = snapshot.get();
+        indexOptions.iterate_upper_bound = &upperBound;
+        rocksdb::ReadOptions recordOptions;
+        recordOptions.snapshot = snapshot.get();
+
+        size_t ctr = 0;
+        std::unique_ptr<rocksdb::Iterator> indexIter(_db->NewIterator(indexOptions, indexHandle));
+        std::unique_ptr<rocksdb::Iterator> recordIter(_db->NewIterator(recordOptions));
+        for (indexIter->Seek(toSlice(startKey)); indexIter->Valid(); indexIter->Next())
+        {
+            const auto [timestamp, index] = decodeTimeIndexKey(indexIter->key());
+            const IndexKey recordKey      = encodeIndexKey(index);
+            if (recordIter->Valid() && recordIter->key().compare(toSlice(recordKey)) < 0)
+            {
+                recordIter->Next();
+            }
+            if (!recordIter->Valid() || recordIter->key() != toSlice(recordKey))
+            {
+                recordIter->Seek(toSlice(recordKey));
+            }
+            if (recordIter->Valid() && recordIter->key() == toSlice(recordKey))
+            {
+                callback(index, timestamp, recordIter->value());
+                ++ctr;
+            }
+        }
+        if (!indexIter->status().ok())
+        {
+            throw std::invalid_argument(indexIter->status().ToString());
+        }
+        if (!recordIter->status().ok())
+        {
+            throw std::invalid_argument(recordIter->status().ToString());
+        }
+        return ctr;
+    }
+
+    /**
+     * @return widths of the rollup column families, ascending
+     */
+    std::vector<uint64_t> RollupWidths() const
+    {
+        std::vector<uint64_t> widths;
+        for (rocksdb::ColumnFamilyHandle *handle : _vecHandle)
+        {
+            if (const uint64_t width = rollupWidth(handle->GetName()))
+            {
+                widths.push_back(width);
+            }
+        }
+        std::sort(widths.begin(), widths.end());
+        return widths;
+    }
+
+    /**
+     * @return the finest rollup width with at most maxPoints buckets in [startTime, endTime),
+     * the coarsest width if none is coarse enough
+     */
+    uint64_t ChooseRollupWidth(uint64_t startTime, uint64_t endTime, size_t maxPoints) const
+    {
+        const std::vector<uint64_t> widths = RollupWidths();
+        if (widths.empty())
+        {
+            throw std::invalid_argument("No rollup columns found");
+        }
+        for (uint64_t width : widths)
+        {
+            const uint64_t first = startTime - startTime % width;
+            if (endTime <= first || (endTime - first - 1) / width < maxPoints)
+            {
+                return width;
+            }
+        }
+        return widths.back();
+    }
+
+    /**
+     * @brief Calls callback(const RollupBucket &) for every non empty bucket of the width overlapping
+     * [startTime, endTime), ascending by start. Needs the rollups written by DBCreator::createRollupColumns.
+     * @return number of visited buckets
+     */
+    template <typename Callback>
+    size_t ReadRollup(uint64_t width, uint64_t startTime, uint64_t endTime, Callback &&callback)
+    {
+        const IndexKey startKey = encodeIndexKey(startTime - startTime % width);
+        const IndexKey endKey   = encodeIndexKey(endTime);
+        const rocksdb::Slice upperBound(toSlice(endKey));
+        rocksdb::ReadOptions options;
+        options.iterate_upper_bound = &upperBound;
+
+        size_t ctr = 0;
+        RollupBucket bucket;
+        bucket.width = width;
+        std::unique_ptr<rocksdb::Iterator> iter(_db->NewIterator(options, requireColumn(rollupColumn(width))));
+        for (iter->Seek(toSlice(startKey)); iter->Valid(); iter->Next())
+        {
+            if (!RollupCodec::decode(iter->value(), bucket))
+            {
+                throw std::invalid_argument("Error while parsing");
+            }
+            bucket.start = decodeIndexKey(iter->key());
+            callback(static_cast<const RollupBucket &>(bucket));
+            ++ctr;
+        }
+        if (!iter->status().ok())
+        {
+            throw std::invalid_argument(iter->status().ToString());
+        }
+        return ctr;
+    }
+
+    /**
+     * @brief ReadRollup with the width chosen by ChooseRollupWidth, so a long range is read as at most
+     * maxPoints buckets if the rollups are coarse enough.
+     */
+    template <typename Callback>
+    size_t ReadRollups(uint64_t startTime, uint64_t endTime, size_t maxPoints, Callback &&callback)
+    {
+        return ReadRollup(ChooseRollupWidth(startTime, endTime, maxPoints), startTime, endTime, std::forward<Callback>(callback));
+    }
+
+    /**
+     * @brief Reads record index of a column family written with DBCreator::appendChunkedMsg.
+     * The chunk holding the record is the one with the largest key not above the index.
+     */
+    void ReadChunkedMsg(const std::string &column, uint64_t index, google::protobuf::Message *msg)
+    {
+        const IndexKey key = encodeIndexKey(index);
+        std::unique_ptr<rocksdb::Iterator> iter(_db->NewIterator(rocksdb::ReadOptions(), requireColumn(column)));
+        iter->SeekForPrev(toSlice(key));
+        if (!iter->status().ok())
+        {
+            throw std::invalid_argument(iter->status().ToString());
+        }
+        if (iter->Valid())
+        {
+            const uint64_t start = decodeIndexKey(iter->key());
+            parseChunk(iter->value());
+            const size_t pos = index - start <= UINT32_MAX ? _chunk.lowerBound(static_cast<uint32_t>(index - start)) : _chunk.size();
+            if (pos < _chunk.size() && start + _chunk.offset(pos) == index)
+            {
+                parseFromSlice(_chunk.record(pos), msg);
+                return;
+            }
+        }
+        throw std::invalid_argument(rocksdb::Status::NotFound().ToString());
+    }
+
+    /**
+     * @brief ReadRange for a chunked column family: calls callback(index, value) for every record in
+     * [startIndex, endIndex) in ascending order, one iterator step per chunk instead of per record.
+     * The value slice is only valid during the callback.
+     * @return number of visited records
+     */
+    template <typename Callback>
+    size_t ReadChunkedRange(const std::string &column, uint64_t startIndex, uint64_t endIndex, Callback &&callback)
+    {
+        const IndexKey startKey = encodeIndexKey(startIndex);
+        const IndexKey endKey   = encodeIndexKey(endIndex);
+        const rocksdb::Slice upperBound(toSlice(endKey));
+        rocksdb::ReadOptions options;
+        options.iterate_upper_bound = &upperBound;
+
+        size_t ctr = 0;
+        std::unique_ptr<rocksdb::Iterator> iter(_db->NewIterator(options, requireColumn(column)));
+        // the chunk in front of startIndex may still hold records of the range
+        iter->SeekForPrev(toSlice(startKey));
+        if (!iter->Valid())
+        {
+            iter->Seek(toSlice(startKey));
+        }
+        for (; iter->Valid(); iter->Next())
+        {
+            const uint64_t start = decodeIndexKey(iter->key());
+            parseChunk(iter->value());
+            size_t pos = startIndex > start ? _chunk.lowerBound(static_cast<uint32_t>(std::min<uint64_t>(startIndex - start, UINT32_MAX))) : 0;
+            for (; pos < _chunk.size() && start + _chunk.offset(pos) < endIndex; ++pos)
+            {
+                callback(start + _chunk.offset(pos), _chunk.record(pos));
+                ++ctr;
+            }
+        }
+        if (!iter->status().ok())
+        {
+            throw std::invalid_argument(iter->status().ToString());
+        }
+        return ctr;
+    }
+
+    /**
+     * @brief Registry of the schemas in the typed record column, read from the desc column on first use.
+     */
+    const SchemaRegistry &Schemas()
+    {
+        if (!_registryLoaded)
+        {
+            ReloadSchemas();
+        }
+        return _registry;
+    }
+
+    /**
+     * @brief Reads the registry again, e.g. after TryCatchUpWithPrimary picked up new schemas.
+     */
+    void ReloadSchemas()
+    {
+        _registry.load(_db, requireColumn("desc"));
+        _registryLoaded = true;
+    }
+
+    /**
+     * @brief Reads record index of a registered schema into a new message of the schema's type.
+     */
+    std::unique_ptr<google::protobuf::Message> ReadTypedMsg(uint32_t schemaId, uint64_t index)
+    {
+        std::unique_ptr<google::protobuf::Message> msg(Schemas().require(schemaId).prototype().New());
+        readInto(requireColumn(typedRecordColumn), toSlice(encodeTypedKey(schemaId, index)), msg.get());
+        return msg;
+    }
+
+    /**
+     * @brief Like ReadTypedMsg above, msg has to be of the schema's type.
+     */
+    void ReadTypedMsg(uint32_t schemaId, uint64_t index, google::protobuf::Message *msg)
+    {
+        readInto(requireColumn(typedRecordColumn), toSlice(encodeTypedKey(schemaId, index)), msg);
+    }
+
+    /**
+     * @brief ReadRange over the records of one schema: calls callback(index, value) for every record in
+     * [startIndex, endIndex) in ascending order. Records of other schemas are not touched.
+     * @return number of visited records
+     */
+    template <typename Callback>
+    size_t ReadTypedRange(uint32_t schemaId, uint64_t startIndex, uint64_t endIndex, Callback &&callback)
+    {
+        return scanTyped(schemaId, startIndex, endIndex, callback);
+    }
+
+    /**
+     * @brief Like ReadTypedRange above, but parses every record into msg and calls callback(index, *msg).
+     */
+    template <typename Callback>
+    size_t ReadTypedRange(uint32_t schemaId, uint64_t startIndex, uint64_t endIndex, google::protobuf::Message *msg, Callback &&callback)
+    {
+        return scanTyped(schemaId, startIndex, endIndex, [this, msg, &callback](uint64_t index, const rocksdb::Slice &value) {
+            parseFromSlice(value, msg);
+            callback(index, *msg);
+        });
+    }
+
+    /**
+     * @brief Calls callback(schema, index, msg) for the records in [startIndex, endIndex) of every registered schema,
+     * schema by schema. Each record is parsed into a message of its schema's type, resolved from the registry.
+     * @return number of visited records
+     */
+    template <typename Callback>
+    size_t ReadAllTypes(uint64_t startIndex, uint64_t endIndex, Callback &&callback)
+    {
+        size_t ctr = 0;
+        for (const auto &it : Schemas())
+        {
+            const RegisteredSchema &schema = it.second;
+            std::unique_ptr<google::protobuf::Message> msg(schema.prototype().New());
+            ctr += scanTyped(schema.id, startIndex, endIndex, [&](uint64_t index, const rocksdb::Slice &value) {
+                parseFromSlice(value, msg.get());
+                callback(schema, index, static_cast<const google::protobuf::Message &>(*msg));
+            });
+        }
+        return ctr;
+    }
+
+    /**
+     * @return total size of the sst files of the column family, as reported by rocksdb
+     */
+    uint64_t ColumnBytes(const std::string &column)
+    {
+        uint64_t bytes = 0;
+        _db->GetIntProperty(requireColumn(column), rocksdb::DB::Properties::kTotalSstFilesSize, &bytes);
+        return bytes;
+    }
+
+    template <typename Callback>
+    size_t ReadRange(const msgDesc &desc, Callback &&callback)
+    {
+        return ReadRange(desc.startindex(), desc.endindex(), std::forward<Callback>(callback));
+    }
+};
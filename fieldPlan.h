@@ -0,0 +1,229 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+
+template <typename T>
+constexpr google::protobuf::FieldDescriptor::CppType cppTypeOf()
+{
+    using google::protobuf::FieldDescriptor;
+    if constexpr (std::is_same_v<T, int32_t>)
+    {
+        return FieldDescriptor::CPPTYPE_INT32;
+    }
+    else if constexpr (std::is_same_v<T, int64_t>)
+    {
+        return FieldDescriptor::CPPTYPE_INT64;
+    }
+    else if constexpr (std::is_same_v<T, uint32_t>)
+    {
+        return FieldDescriptor::CPPTYPE_UINT32;
+    }
+    else if constexpr (std::is_same_v<T, uint64_t>)
+    {
+        return FieldDescriptor::CPPTYPE_UINT64;
+    }
+    else if constexpr (std::is_same_v<T, float>)
+    {
+        return FieldDescriptor::CPPTYPE_FLOAT;
+    }
+    else if constexpr (std::is_same_v<T, double>)
+    {
+        return FieldDescriptor::CPPTYPE_DOUBLE;
+    }
+    else if constexpr (std::is_same_v<T, bool>)
+    {
+        return FieldDescriptor::CPPTYPE_BOOL;
+    }
+    else
+    {
+        static_assert(std::is_same_v<T, std::string>, "Unsupported field type");
+        return FieldDescriptor::CPPTYPE_STRING;
+    }
+}
+
+/**
+ * @brief Resolves a fixed list of fields of a dynamic message once, by name and type.
+ * The plan is built once per Descriptor and then used for every record, so the typed getters and setters
+ * and the bulk fill/extract do no name lookup and no type dispatch at runtime.
+ * Slot I of the plan has the C++ type Ts[I]; a mismatch with the schema is reported when building the plan.
+ *
+ * Usage with a plain struct:
+ *     FieldPlan<uint32_t, int32_t, int32_t> plan(desc, {"oltc", "voltage", "current"});
+ *     plan.fill(msg, std::tie(rec.oltc, rec.voltage, rec.current));
+ */
+template <typename... Ts>
+class FieldPlan
+{
+private:
+    const google::protobuf::Descriptor *_desc = nullptr;
+    std::array<const google::protobuf::FieldDescriptor *, sizeof...(Ts)> _fields{};
+
+    template <typename T>
+    static void setField(const google::protobuf::Reflection *reflection, google::protobuf::Message *msg,
+                         const google::protobuf::FieldDescriptor *field, const T &value)
+    {
+        if constexpr (std::is_same_v<T, int32_t>)
+        {
+            reflection->SetInt32(msg, field, value);
+        }
+        else if constexpr (std::is_same_v<T, int64_t>)
+        {
+            reflection->SetInt64(msg, field, value);
+        }
+        else if constexpr (std::is_same_v<T, uint32_t>)
+        {
+            reflection->SetUInt32(msg, field, value);
+        }
+        else if constexpr (std::is_same_v<T, uint64_t>)
+        {
+            reflection->SetUInt64(msg, field, value);
+        }
+        else if constexpr (std::is_same_v<T, float>)
+        {
+            reflection->SetFloat(msg, field, value);
+        }
+        else if constexpr (std::is_same_v<T, double>)
+        {
+            reflection->SetDouble(msg, field, value);
+        }
+        else if constexpr (std::is_same_v<T, bool>)
+        {
+            reflection->SetBool(msg, field, value);
+        }
+        else
+        {
+            reflection->SetString(msg, field, value);
+        }
+    }
+
+    template <typename T>
+    static T getField(const google::protobuf::Reflection *reflection, const google::protobuf::Message &msg,
+                      const google::protobuf::FieldDescriptor *field)
+    {
+        if constexpr (std::is_same_v<T, int32_t>)
+        {
+            return reflection->GetInt32(msg, field);
+        }
+        else if constexpr (std::is_same_v<T, int64_t>)
+        {
+            return reflection->GetInt64(msg, field);
+        }
+        else if constexpr (std::is_same_v<T, uint32_t>)
+        {
+            return reflection->GetUInt32(msg, field);
+        }
+        else if constexpr (std::is_same_v<T, uint64_t>)
+        {
+            return reflection->GetUInt64(msg, field);
+        }
+        else if constexpr (std::is_same_v<T, float>)
+        {
+            return reflection->GetFloat(msg, field);
+        }
+        else if constexpr (std::is_same_v<T, double>)
+        {
+            return reflection->GetDouble(msg, field);
+        }
+        else if constexpr (std::is_same_v<T, bool>)
+        {
+            return reflection->GetBool(msg, field);
+        }
+        else
+        {
+            return reflection->GetString(msg, field);
+        }
+    }
+
+    template <typename Tuple, size_t... I>
+    void fillImpl(google::protobuf::Message *msg, const Tuple &values, std::index_sequence<I...>) const
+    {
+        const google::protobuf::Reflection *reflection = msg->GetReflection();
+        (setField<Ts>(reflection, msg, _fields[I], std::get<I>(values)), ...);
+    }
+
+    template <typename Tuple, size_t... I>
+    void extractImpl(const google::protobuf::Message &msg, Tuple &values, std::index_sequence<I...>) const
+    {
+        const google::protobuf::Reflection *reflection = msg.GetReflection();
+        ((std::get<I>(values) = getField<Ts>(reflection, msg, _fields[I])), ...);
+    }
+
+public:
+    using Slot = std::tuple<Ts...>;
+
+    FieldPlan(const google::protobuf::Descriptor *desc, const std::array<const char *, sizeof...(Ts)> &names) : _desc(desc)
+    {
+        constexpr std::array<google::protobuf::FieldDescriptor::CppType, sizeof...(Ts)> types{cppTypeOf<Ts>()...};
+        for (size_t slot = 0; slot < names.size(); ++slot)
+        {
+            const google::protobuf::FieldDescriptor *field = desc->FindFieldByName(names[slot]);
+            if (!field)
+            {
+                throw std::invalid_argument(std::string("Unknown field ") + names[slot] + " in " + desc->full_name());
+            }
+            if (field->is_repeated() || field->cpp_type() != types[slot])
+            {
+                throw std::invalid_argument(std::string("Type mismatch for field ") + names[slot] + ", schema has " + field->cpp_type_name());
+            }
+            _fields[slot] = field;
+        }
+    }
+
+    const google::protobuf::Descriptor *descriptor() const
+    {
+        return _desc;
+    }
+
+    const google::protobuf::FieldDescriptor *field(size_t slot) const
+    {
+        return _fields[slot];
+    }
+
+    template <size_t I>
+    void set(google::protobuf::Message *msg, const std::tuple_element_t<I, Slot> &value) const
+    {
+        setField<std::tuple_element_t<I, Slot>>(msg->GetReflection(), msg, _fields[I], value);
+    }
+
+    template <size_t I>
+    std::tuple_element_t<I, Slot> get(const google::protobuf::Message &msg) const
+    {
+        return getField<std::tuple_element_t<I, Slot>>(msg.GetReflection(), msg, _fields[I]);
+    }
+
+    /**
+     * @brief Sets all planned fields from a tuple, or a std::tie of struct members, in slot order.
+     */
+    template <typename Tuple>
+    void fill(google::protobuf::Message *msg, const Tuple &values) const
+    {
+        static_assert(std::tuple_size_v<std::decay_t<Tuple>> == sizeof...(Ts), "Tuple does not match the plan");
+        fillImpl(msg, values, std::index_sequence_for<Ts...>{});
+    }
+
+    /**
+     * @brief Reads all planned fields into a tuple, or a std::tie of struct members, in slot order.
+     */
+    template <typename Tuple>
+    void extract(const google::protobuf::Message &msg, Tuple &&values) const
+    {
+        static_assert(std::tuple_size_v<std::decay_t<Tuple>> == sizeof...(Ts), "Tuple does not match the plan");
+        extractImpl(msg, values, std::index_sequence_for<Ts...>{});
+    }
+
+    Slot extract(const google::protobuf::Message &msg) const
+    {
+        Slot values;
+        extract(msg, values);
+        return values;
+    }
+};
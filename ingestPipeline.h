@@ -0,0 +1,451 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <rocksdb/db.h>
+#include <rocksdb/write_batch.h>
+
+#include <google/protobuf/message.h>
+
+#include "dbCreator.h"
+#include "keyCodec.h"
+
+/**
+ * @brief Bounded lock-free queue after Dmitry Vyukov's bounded MPMC queue: every cell carries a sequence
+ * number telling producers and consumers whose turn it is, so neither side takes a lock.
+ * Used with many producers and one or a few consumers. The capacity is rounded up to a power of two.
+ */
+template <typename T>
+class BoundedQueue
+{
+private:
+    struct Cell
+    {
+        std::atomic<size_t> sequence{0};
+        T value;
+    };
+
+    std::unique_ptr<Cell[]> _cells;
+    size_t _mask = 0;
+    alignas(64) std::atomic<size_t> _enqueuePos{0};
+    alignas(64) std::atomic<size_t> _dequeuePos{0};
+
+public:
+    explicit BoundedQueue(size_t capacity)
+    {
+        size_t size = 2;
+        while (size < capacity)
+        {
+            size *= 2;
+        }
+        _cells.reset(new Cell[size]);
+        _mask = size - 1;
+        for (size_t pos = 0; pos < size; ++pos)
+        {
+            _cells[pos].sequence.store(pos, std::memory_order_relaxed);
+        }
+    }
+
+    BoundedQueue(const BoundedQueue &) = delete;
+    BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+    /**
+     * @return false if the queue is full, value is left untouched then
+     */
+    bool tryPush(T &&value)
+    {
+        Cell *cell = nullptr;
+        size_t pos = _enqueuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell                = &_cells[pos & _mask];
+            const size_t seq    = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos);
+            if (0 == diff)
+            {
+                if (_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = _enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = std::move(value);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @return false if the queue is empty
+     */
+    bool tryPop(T &value)
+    {
+        Cell *cell = nullptr;
+        size_t pos = _dequeuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            cell                = &_cells[pos & _mask];
+            const size_t seq    = cell->sequence.load(std::memory_order_acquire);
+            const intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(pos + 1);
+            if (0 == diff)
+            {
+                if (_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = _dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        value = std::move(cell->value);
+        cell->sequence.store(pos + _mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    size_t capacity() const
+    {
+        return _mask + 1;
+    }
+
+    /**
+     * @brief Number of pushes started so far, the position the next push gets
+     */
+    size_t enqueued() const
+    {
+        return _enqueuePos.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Number of pops started so far
+     */
+    size_t dequeued() const
+    {
+        return _dequeuePos.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Approximate number of queued values
+     */
+    size_t size() const
+    {
+        const size_t dequeuePos = dequeued();
+        const size_t enqueuePos = enqueued();
+        return enqueuePos > dequeuePos ? enqueuePos - dequeuePos : 0;
+    }
+};
+
+struct IngestOptions
+{
+    size_t queueCapacity = 8192;
+    size_t writerThreads = 1;
+    // a writer commits as soon as the queue runs empty or one of these is reached
+    size_t maxBatchCount = 1000;
+    size_t maxBatchBytes = 4 * 1024 * 1024;
+    bool disableWAL      = true;
+};
+
+/**
+ * @brief Counters of an IngestPipeline. The latency is measured from push to the commit of the batch.
+ */
+struct IngestStats
+{
+    uint64_t pushed        = 0;
+    uint64_t committed     = 0;
+    uint64_t failed        = 0;
+    uint64_t batches       = 0;
+    uint64_t producerWaits = 0;
+    size_t queueDepth      = 0;
+    size_t maxQueueDepth   = 0;
+    std::chrono::nanoseconds meanLatency{0};
+    std::chrono::nanoseconds maxLatency{0};
+};
+
+/**
+ * @brief Ingest path for many producer threads. Producers serialize on their own thread and hand the records
+ * through a BoundedQueue to the writer threads, which commit them as WriteBatches into the default column family
+ * of the DBCreator. A full queue blocks the producers (backpressure), flush() waits until everything pushed
+ * before is committed. The batches are committed through the DBCreator, so they show up in its metrics and the
+ * committed indices are invalidated in its current record cache. The pending batch of the DBCreator is flushed when
+ * the pipeline starts; don't append to the DBCreator meanwhile, the order of both paths is undefined.
+ * The pipeline has to be destroyed before its DBCreator, the destructor commits the queued records.
+ */
+class IngestPipeline
+{
+private:
+    struct Record
+    {
+        uint64_t index = 0;
+        std::string value;
+        std::chrono::steady_clock::time_point pushed;
+    };
+
+    struct Writer
+    {
+        std::thread thread;
+        // advanced after every round of the writer, a round commits everything popped in it
+        std::atomic<uint64_t> round{0};
+    };
+
+    DBCreator &_creator;
+    IngestOptions _options;
+    BoundedQueue<Record> _queue;
+    std::vector<std::unique_ptr<Writer>> _writers;
+    std::atomic<bool> _stop{false};
+
+    std::atomic<uint64_t> _pushed{0};
+    std::atomic<uint64_t> _committed{0};
+    std::atomic<uint64_t> _failed{0};
+    std::atomic<uint64_t> _batches{0};
+    std::atomic<uint64_t> _producerWaits{0};
+    std::atomic<size_t> _maxQueueDepth{0};
+    std::atomic<uint64_t> _latencySum{0};
+    std::atomic<uint64_t> _latencyMax{0};
+
+    std::mutex _errorMtx;
+    std::atomic<bool> _hasError{false};
+    rocksdb::Status _error;
+
+    template <typename Integer>
+    static void updateMax(std::atomic<Integer> &target, Integer value)
+    {
+        Integer current = target.load(std::memory_order_relaxed);
+        while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    /**
+     * @brief Spins first, then yields and finally sleeps up to a millisecond
+     */
+    static void backoff(unsigned &attempt)
+    {
+        if (attempt >= 128)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(std::min(1000u, attempt - 127)));
+        }
+        else if (attempt >= 64)
+        {
+            std::this_thread::yield();
+        }
+        ++attempt;
+    }
+
+    void throwIfFailed()
+    {
+        if (_hasError.load(std::memory_order_acquire))
+        {
+            std::lock_guard<std::mutex> lock(_errorMtx);
+            throw std::invalid_argument(_error.ToString());
+        }
+    }
+
+    void commit(rocksdb::WriteBatch &batch, std::vector<std::chrono::steady_clock::time_point> &pushed, std::vector<uint64_t> &indices)
+    {
+        rocksdb::WriteOptions options;
+        options.disableWAL     = _options.disableWAL;
+        rocksdb::Status status = _creator.commitExternal(options, batch, indices);
+        if (!status.ok())
+        {
+            std::lock_guard<std::mutex> lock(_errorMtx);
+            if (!_hasError.load(std::memory_order_relaxed))
+            {
+                _error = status;
+                _hasError.store(true, std::memory_order_release);
+            }
+            _failed.fetch_add(pushed.size(), std::memory_order_relaxed);
+        }
+        else
+        {
+            const auto now   = std::chrono::steady_clock::now();
+            uint64_t sum     = 0;
+            uint64_t maximum = 0;
+            for (const auto &time : pushed)
+            {
+                const uint64_t latency = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - time).count());
+                sum += latency;
+                maximum = std::max(maximum, latency);
+            }
+            _latencySum.fetch_add(sum, std::memory_order_relaxed);
+            updateMax(_latencyMax, maximum);
+            _committed.fetch_add(pushed.size(), std::memory_order_release);
+        }
+        _batches.fetch_add(1, std::memory_order_relaxed);
+        batch.Clear();
+        pushed.clear();
+        indices.clear();
+    }
+
+    void run(Writer &writer)
+    {
+        rocksdb::WriteBatch batch;
+        std::vector<std::chrono::steady_clock::time_point> pushed;
+        std::vector<uint64_t> indices;
+        Record record;
+        unsigned attempt = 0;
+        for (;;)
+        {
+            const bool stop = _stop.load(std::memory_order_acquire);
+            updateMax(_maxQueueDepth, _queue.size());
+            while (batch.Count() < _options.maxBatchCount && batch.GetDataSize() < _options.maxBatchBytes && _queue.tryPop(record))
+            {
+                batch.Put(toSlice(encodeIndexKey(record.index)), record.value);
+                pushed.push_back(record.pushed);
+                indices.push_back(record.index);
+            }
+            if (batch.Count())
+            {
+                commit(batch, pushed, indices);
+                attempt = 0;
+            }
+            else if (stop)
+            {
+                return;
+            }
+            else
+            {
+                backoff(attempt);
+            }
+            writer.round.fetch_add(1, std::memory_order_release);
+        }
+    }
+
+public:
+    explicit IngestPipeline(DBCreator &creator, const IngestOptions &options = IngestOptions())
+        : _creator(creator), _options(options), _queue(options.queueCapacity)
+    {
+        if (!_creator._db || 0 == options.writerThreads)
+        {
+            throw std::invalid_argument("Ingest pipeline needs a created database and at least one writer");
+        }
+        // the records appended before go first
+        _creator.flush();
+        for (size_t ctr = 0; ctr < options.writerThreads; ++ctr)
+        {
+            _writers.push_back(std::make_unique<Writer>());
+            Writer &writer = *_writers.back();
+            writer.thread  = std::thread([this, &writer]() { run(writer); });
+        }
+    }
+
+    ~IngestPipeline()
+    {
+        _stop.store(true, std::memory_order_release);
+        for (auto &writer : _writers)
+        {
+            writer->thread.join();
+        }
+    }
+
+    IngestPipeline(const IngestPipeline &) = delete;
+    IngestPipeline &operator=(const IngestPipeline &) = delete;
+
+    /**
+     * @brief Queues an already serialized record. Blocks while the queue is full.
+     */
+    void push(uint64_t index, std::string &&value)
+    {
+        throwIfFailed();
+        Record record{index, std::move(value), std::chrono::steady_clock::now()};
+        if (!_queue.tryPush(std::move(record)))
+        {
+            _producerWaits.fetch_add(1, std::memory_order_relaxed);
+            unsigned attempt = 0;
+            do
+            {
+                backoff(attempt);
+            } while (!_queue.tryPush(std::move(record)));
+        }
+        _pushed.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Serializes msg on the calling thread and queues it.
+     */
+    void push(uint64_t index, const google::protobuf::Message *msg)
+    {
+        std::string value;
+        msg->SerializeToString(&value);
+        push(index, std::move(value));
+    }
+
+    /**
+     * @return false without waiting if the queue is full
+     */
+    bool tryPush(uint64_t index, std::string &&value)
+    {
+        throwIfFailed();
+        Record record{index, std::move(value), std::chrono::steady_clock::now()};
+        if (!_queue.tryPush(std::move(record)))
+        {
+            value = std::move(record.value);
+            return false;
+        }
+        _pushed.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @brief Barrier: returns once every record pushed before the call is committed.
+     * Waits until those records are popped, then for one more round of every writer,
+     * as a writer commits all records popped in a round before finishing it.
+     */
+    void flush()
+    {
+        const size_t target = _queue.enqueued();
+        unsigned attempt    = 0;
+        while (_queue.dequeued() < target)
+        {
+            backoff(attempt);
+        }
+        for (auto &writer : _writers)
+        {
+            const uint64_t round = writer->round.load(std::memory_order_acquire);
+            attempt              = 0;
+            while (writer->round.load(std::memory_order_acquire) <= round)
+            {
+                backoff(attempt);
+            }
+        }
+        throwIfFailed();
+    }
+
+    IngestStats stats() const
+    {
+        IngestStats stats;
+        stats.pushed        = _pushed.load(std::memory_order_relaxed);
+        stats.committed     = _committed.load(std::memory_order_relaxed);
+        stats.failed        = _failed.load(std::memory_order_relaxed);
+        stats.batches       = _batches.load(std::memory_order_relaxed);
+        stats.producerWaits = _producerWaits.load(std::memory_order_relaxed);
+        stats.queueDepth    = _queue.size();
+        stats.maxQueueDepth = _maxQueueDepth.load(std::memory_order_relaxed);
+        stats.maxLatency    = std::chrono::nanoseconds(_latencyMax.load(std::memory_order_relaxed));
+        if (stats.committed)
+        {
+            stats.meanLatency = std::chrono::nanoseconds(_latencySum.load(std::memory_order_relaxed) / stats.committed);
+        }
+        return stats;
+    }
+};
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#include <rocksdb/slice.h>
+
+/**
+ * @brief Record keys are the record index as fixed width big endian integer.
+ * The bytewise comparator of rocksdb then sorts the keys in numeric order,
+ * so consecutive indices are neighbours on disk and a range can be read with one iterator.
+ */
+using IndexKey = std::array<char, sizeof(uint64_t)>;
+
+constexpr IndexKey encodeIndexKey(uint64_t index)
+{
+    IndexKey key{};
+    for (size_t pos = key.size(); pos > 0; --pos)
+    {
+        key[pos - 1] = static_cast<char>(index & 0xFF);
+        index >>= 8;
+    }
+    return key;
+}
+
+template <size_t N>
+rocksdb::Slice toSlice(const std::array<char, N> &key)
+{
+    return rocksdb::Slice(key.data(), key.size());
+}
+
+inline uint64_t decodeIndexKey(const rocksdb::Slice &key)
+{
+    if (key.size() != sizeof(uint64_t))
+    {
+        throw std::invalid_argument("Invalid index key size " + std::to_string(key.size()));
+    }
+    uint64_t index = 0;
+    for (size_t pos = 0; pos < sizeof(uint64_t); ++pos)
+    {
+        index = (index << 8) | static_cast<uint8_t>(key[pos]);
+    }
+    return index;
+}
+
+/**
+ * @brief The optional time index lives in its own column family. Its keys are the big endian
+ * timestamp followed by the record index, so records sharing a timestamp get distinct entries
+ * and a time range is one contiguous key range. The values are empty.
+ */
+constexpr const char *timeIndexColumn = "timeIndex";
+
+using TimeIndexKey = std::array<char, 2 * sizeof(uint64_t)>;
+
+inline TimeIndexKey encodeTimeIndexKey(uint64_t timestamp, uint64_t index)
+{
+    TimeIndexKey key;
+    const IndexKey timestampKey = encodeIndexKey(timestamp);
+    const IndexKey indexKey     = encodeIndexKey(index);
+    std::copy(timestampKey.begin(), timestampKey.end(), key.begin());
+    std::copy(indexKey.begin(), indexKey.end(), key.begin() + sizeof(uint64_t));
+    return key;
+}
+
+/**
+ * @return timestamp and record index
+ */
+inline std::pair<uint64_t, uint64_t> decodeTimeIndexKey(const rocksdb::Slice &key)
+{
+    if (key.size() != 2 * sizeof(uint64_t))
+    {
+        throw std::invalid_argument("Invalid time index key size " + std::to_string(key.size()));
+    }
+    return {decodeIndexKey(rocksdb::Slice(key.data(), sizeof(uint64_t))),
+            decodeIndexKey(rocksdb::Slice(key.data() + sizeof(uint64_t), sizeof(uint64_t)))};
+}
+
+/**
+ * @brief Records of registered schemas (see SchemaRegistry) share their own column family. Their keys are
+ * the big endian schema id followed by the record index, so the records of one type form one contiguous key
+ * range and the 4 byte schema id is the prefix for the prefix extractor and the prefix bloom filters.
+ * The name is reserved, readers open the column family with the typed record options by its name.
+ */
+constexpr const char *typedRecordColumn = "typed/records";
+
+constexpr size_t schemaIdSize = sizeof(uint32_t);
+
+using TypedKey = std::array<char, schemaIdSize + sizeof(uint64_t)>;
+
+constexpr TypedKey encodeTypedKey(uint32_t schemaId, uint64_t index)
+{
+    TypedKey key{};
+    for (size_t pos = schemaIdSize; pos > 0; --pos)
+    {
+        key[pos - 1] = static_cast<char>(schemaId & 0xFF);
+        schemaId >>= 8;
+    }
+    const IndexKey indexKey = encodeIndexKey(index);
+    for (size_t pos = 0; pos < indexKey.size(); ++pos)
+    {
+        key[schemaIdSize + pos] = indexKey[pos];
+    }
+    return key;
+}
+
+/**
+ * @return schema id and record index
+ */
+inline std::pair<uint32_t, uint64_t> decodeTypedKey(const rocksdb::Slice &key)
+{
+    if (key.size() != schemaIdSize + sizeof(uint64_t))
+    {
+        throw std::invalid_argument("Invalid typed key size " + std::to_string(key.size()));
+    }
+    uint32_t schemaId = 0;
+    for (size_t pos = 0; pos < schemaIdSize; ++pos)
+    {
+        schemaId = (schemaId << 8) | static_cast<uint8_t>(key[pos]);
+    }
+    return {schemaId, decodeIndexKey(rocksdb::Slice(key.data() + schemaIdSize, sizeof(uint64_t)))};
+}
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <thread>
+
+#include <rocksdb/slice.h>
+
+#include "dbReader.h"
+
+struct TailOptions
+{
+    // zero: no poll thread, the owner calls poll()
+    std::chrono::milliseconds pollInterval{100};
+};
+
+/**
+ * @brief Follows a database while a DBCreator keeps writing to it. The reader has to be opened with
+ * DBReader::OpenAsSecondary, so the writer is never blocked. The writer must keep the WAL on, see
+ * BatchOptions::disableWAL, a secondary only catches up with flushed or logged writes. Every poll catches up with the primary and hands
+ * the records written since the last poll to each subscriber, by ascending index. A poll thread makes the
+ * latency bounded by the poll interval plus the time of the catch up.
+ * Callbacks run on the polling thread, one at a time, and must not subscribe or unsubscribe.
+ */
+class LiveTail
+{
+public:
+    using Callback = std::function<void(uint64_t index, const rocksdb::Slice &value)>;
+
+private:
+    struct Subscription
+    {
+        uint64_t next = 0;
+        Callback callback;
+    };
+
+    DBReader &_reader;
+    TailOptions _options;
+    std::mutex _mtx;
+    std::map<uint64_t, Subscription> _subscriptions;
+    uint64_t _nextId = 1;
+    std::exception_ptr _error;
+
+    std::mutex _stopMtx;
+    std::condition_variable _stopCv;
+    bool _stop = false;
+    std::thread _thread;
+
+    size_t deliver()
+    {
+        _reader.TryCatchUpWithPrimary();
+        size_t ctr = 0;
+        for (auto &it : _subscriptions)
+        {
+            Subscription &subscription = it.second;
+            // the index UINT64_MAX is the exclusive end, it can't be tailed
+            ctr += _reader.ReadRange(subscription.next, UINT64_MAX, [&subscription](uint64_t index, const rocksdb::Slice &value) {
+                subscription.callback(index, value);
+                subscription.next = index + 1;
+            });
+        }
+        return ctr;
+    }
+
+    void run()
+    {
+        std::unique_lock<std::mutex> stopLock(_stopMtx);
+        while (!_stopCv.wait_for(stopLock, _options.pollInterval, [this]() { return _stop; }))
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            try
+            {
+                deliver();
+            }
+            catch (...)
+            {
+                // the poll thread stops, error() and poll() report why
+                _error = std::current_exception();
+                return;
+            }
+        }
+    }
+
+public:
+    explicit LiveTail(DBReader &reader, const TailOptions &options = TailOptions()) : _reader(reader), _options(options)
+    {
+        if (_options.pollInterval.count() > 0)
+        {
+            _thread = std::thread([this]() { run(); });
+        }
+    }
+
+    ~LiveTail()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_stopMtx);
+            _stop = true;
+        }
+        _stopCv.notify_all();
+        if (_thread.joinable())
+        {
+            _thread.join();
+        }
+    }
+
+    LiveTail(const LiveTail &) = delete;
+    LiveTail &operator=(const LiveTail &) = delete;
+
+    /**
+     * @brief Delivers the records from fromIndex on with the next poll, including the ones already stored.
+     * @return id for unsubscribe
+     */
+    uint64_t subscribe(uint64_t fromIndex, Callback callback)
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _subscriptions[_nextId] = Subscription{fromIndex, std::move(callback)};
+        return _nextId++;
+    }
+
+    /**
+     * @brief The callback is not called anymore once this returns.
+     */
+    void unsubscribe(uint64_t id)
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        _subscriptions.erase(id);
+    }
+
+    /**
+     * @return the error that stopped the poll thread, nullptr while it runs
+     */
+    std::exception_ptr error()
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        return _error;
+    }
+
+    /**
+     * @brief Catches up and delivers the new records right away, independent of the poll thread.
+     * Rethrows the error that stopped the poll thread, if any.
+     * @return number of delivered records
+     */
+    size_t poll()
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        if (_error)
+        {
+            std::rethrow_exception(_error);
+        }
+        return deliver();
+    }
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <memory>
+
+#include <google/protobuf/arena.h>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+
+#include "schemaCache.h"
+
+class MessageCreator
+{
+private:
+    std::shared_ptr<const CompiledSchema> _schema;
+
+public:
+    const google::protobuf::Descriptor *createMessageDesc(const char *text, const char *message_type)
+    {
+        _schema = SchemaCache::instance().fromText(text);
+
+        // As a .proto definition can contain more than one message Type,
+        // select the message type that we are interested in
+        return _schema->findMessageType(message_type);
+    }
+
+    /**
+     * @brief Uses the FileDescriptorProto persisted in desc if available, so reopening a database
+     * does not run the protoc Parser again.
+     */
+    const google::protobuf::Descriptor *createMessageDesc(const msgDesc &desc, const char *message_type)
+    {
+        _schema = SchemaCache::instance().fromDesc(desc);
+        return _schema->findMessageType(message_type);
+    }
+
+    std::unique_ptr<google::protobuf::Message> createNewMessage(const google::protobuf::Descriptor *msgDesc)
+    {
+        return std::unique_ptr<google::protobuf::Message>(_schema->prototype(msgDesc)->New());
+    }
+
+    /**
+     * @brief The message is owned by the arena and freed with it, it must not be deleted.
+     */
+    google::protobuf::Message *createNewMessage(const google::protobuf::Descriptor *msgDesc, google::protobuf::Arena *arena)
+    {
+        return _schema->prototype(msgDesc)->New(arena);
+    }
+
+    /**
+     * @brief Prototype for ArenaBatch, valid as long as the schema stays cached.
+     */
+    const google::protobuf::Message &prototype(const google::protobuf::Descriptor *msgDesc) const
+    {
+        return *_schema->prototype(msgDesc);
+    }
+};
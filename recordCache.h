@@ -0,0 +1,222 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+
+struct RecordCacheStats
+{
+    uint64_t hits          = 0;
+    uint64_t misses        = 0;
+    uint64_t inserts       = 0;
+    uint64_t evictions     = 0;
+    uint64_t invalidations = 0;
+    size_t entries         = 0;
+    size_t bytes           = 0;
+};
+
+/**
+ * @brief Sharded LRU cache of decoded records, keyed by message type and index, see DBReader::ReadCachedMsg.
+ * Every shard holds capacity / shards bytes, charged with the SpaceUsedLong of the messages.
+ * The cached messages are shared and immutable, an evicted message lives on while a reader still holds it.
+ *
+ * Writes of a DBCreator using the cache invalidate the written indices once they are committed. A reader
+ * takes a ticket before reading from rocksdb and inserts with it, the insert is dropped if the shard was
+ * invalidated in between, so an older value can't overwrite an invalidation. Writes of other processes
+ * are not seen.
+ */
+class RecordCache
+{
+public:
+    using Ticket = uint64_t;
+
+private:
+    struct Entry
+    {
+        const google::protobuf::Descriptor *desc = nullptr;
+        uint64_t index                           = 0;
+        std::shared_ptr<const google::protobuf::Message> msg;
+        size_t charge = 0;
+    };
+
+    struct Shard
+    {
+        std::mutex mtx;
+        // front is the most recently used entry
+        std::list<Entry> lru;
+        std::unordered_multimap<uint64_t, std::list<Entry>::iterator> byIndex;
+        size_t bytes        = 0;
+        uint64_t generation = 0;
+    };
+
+    // map, list node and control block per entry
+    static constexpr size_t entryOverhead = 128;
+
+    std::vector<std::unique_ptr<Shard>> _shards;
+    size_t _shardCapacity = 0;
+
+    std::atomic<uint64_t> _hits{0};
+    std::atomic<uint64_t> _misses{0};
+    std::atomic<uint64_t> _inserts{0};
+    std::atomic<uint64_t> _evictions{0};
+    std::atomic<uint64_t> _invalidations{0};
+
+    Shard &shardOf(uint64_t index) const
+    {
+        // consecutive indices are spread over the shards
+        const uint64_t hash = index * 0x9E3779B97F4A7C15ull;
+        return *_shards[(hash >> 32) & (_shards.size() - 1)];
+    }
+
+    static std::list<Entry>::iterator find(Shard &shard, const google::protobuf::Descriptor *desc, uint64_t index)
+    {
+        auto range = shard.byIndex.equal_range(index);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second->desc == desc)
+            {
+                return it->second;
+            }
+        }
+        return shard.lru.end();
+    }
+
+    void erase(Shard &shard, std::list<Entry>::iterator entry)
+    {
+        auto range = shard.byIndex.equal_range(entry->index);
+        for (auto it = range.first; it != range.second; ++it)
+        {
+            if (it->second == entry)
+            {
+                shard.byIndex.erase(it);
+                break;
+            }
+        }
+        shard.bytes -= entry->charge;
+        shard.lru.erase(entry);
+    }
+
+public:
+    /**
+     * @param capacity bytes of all shards together
+     * @param shards rounded up to a power of two
+     */
+    explicit RecordCache(size_t capacity, size_t shards = 16)
+    {
+        size_t count = 1;
+        while (count < shards)
+        {
+            count *= 2;
+        }
+        for (size_t ctr = 0; ctr < count; ++ctr)
+        {
+            _shards.push_back(std::make_unique<Shard>());
+        }
+        _shardCapacity = capacity / count;
+    }
+
+    RecordCache(const RecordCache &) = delete;
+    RecordCache &operator=(const RecordCache &) = delete;
+
+    /**
+     * @return the cached message or nullptr, a miss sets ticket for the following insert
+     */
+    std::shared_ptr<const google::protobuf::Message> lookup(const google::protobuf::Descriptor *desc, uint64_t index, Ticket &ticket)
+    {
+        Shard &shard = shardOf(index);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        auto entry = find(shard, desc, index);
+        if (entry == shard.lru.end())
+        {
+            ticket = shard.generation;
+            _misses.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        shard.lru.splice(shard.lru.begin(), shard.lru, entry);
+        _hits.fetch_add(1, std::memory_order_relaxed);
+        return entry->msg;
+    }
+
+    /**
+     * @brief Caches msg as record index of its type, unless the shard was invalidated since lookup handed out the ticket.
+     * Least recently used entries are evicted until the shard fits into its capacity again.
+     */
+    void insert(uint64_t index, std::shared_ptr<const google::protobuf::Message> msg, Ticket ticket)
+    {
+        const size_t charge = msg->SpaceUsedLong() + entryOverhead;
+        Shard &shard        = shardOf(index);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        if (ticket != shard.generation || charge > _shardCapacity)
+        {
+            return;
+        }
+        auto entry = find(shard, msg->GetDescriptor(), index);
+        if (entry != shard.lru.end())
+        {
+            erase(shard, entry);
+        }
+        shard.lru.push_front(Entry{msg->GetDescriptor(), index, std::move(msg), charge});
+        shard.byIndex.emplace(index, shard.lru.begin());
+        shard.bytes += charge;
+        _inserts.fetch_add(1, std::memory_order_relaxed);
+        while (shard.bytes > _shardCapacity)
+        {
+            erase(shard, std::prev(shard.lru.end()));
+            _evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * @brief Drops record index of every message type and fails the outstanding tickets of its shard.
+     */
+    void invalidate(uint64_t index)
+    {
+        Shard &shard = shardOf(index);
+        std::lock_guard<std::mutex> lock(shard.mtx);
+        ++shard.generation;
+        auto range = shard.byIndex.equal_range(index);
+        while (range.first != range.second)
+        {
+            auto entry = (range.first++)->second;
+            erase(shard, entry);
+            _invalidations.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void clear()
+    {
+        for (auto &shard : _shards)
+        {
+            std::lock_guard<std::mutex> lock(shard->mtx);
+            ++shard->generation;
+            _invalidations.fetch_add(shard->lru.size(), std::memory_order_relaxed);
+            shard->lru.clear();
+            shard->byIndex.clear();
+            shard->bytes = 0;
+        }
+    }
+
+    RecordCacheStats stats() const
+    {
+        RecordCacheStats stats;
+        stats.hits          = _hits.load(std::memory_order_relaxed);
+        stats.misses        = _misses.load(std::memory_order_relaxed);
+        stats.inserts       = _inserts.load(std::memory_order_relaxed);
+        stats.evictions     = _evictions.load(std::memory_order_relaxed);
+        stats.invalidations = _invalidations.load(std::memory_order_relaxed);
+        for (const auto &shard : _shards)
+        {
+            std::lock_guard<std::mutex> lock(shard->mtx);
+            stats.entries += shard->lru.size();
+            stats.bytes   += shard->bytes;
+        }
+        return stats;
+    }
+};
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <string>
+
+#include <rocksdb/compaction_filter.h>
+#include <rocksdb/slice.h>
+
+#include "keyCodec.h"
+
+/**
+ * @brief Maximum age per column family, in timestamp units. Supported are the records (the default column family,
+ * rocksdb::kDefaultColumnFamilyName), the time index and the rollup columns; column families without an entry keep
+ * everything. Expired data is dropped by compaction filters while rocksdb compacts anyway, no tombstones are written.
+ * With deleteFiles, DBCreator::expire additionally drops the table files holding nothing but expired keys.
+ */
+struct RetentionPolicy
+{
+    std::map<std::string, uint64_t> maxAge;
+    bool deleteFiles = false;
+};
+
+/**
+ * @brief Drops the keys whose leading big endian 64 bit value (timestamp, bucket start or record index) lies
+ * completely before the cutoff: a key covers [value, value + span), e.g. span is the bucket width of a rollup.
+ * Merge operands expire like values. The cutoff only grows and is read by the compaction threads without a lock.
+ */
+class RetentionFilter : public rocksdb::CompactionFilter
+{
+private:
+    const uint64_t _span;
+    std::atomic<uint64_t> _cutoff{0};
+
+public:
+    explicit RetentionFilter(uint64_t span = 1) : _span(span)
+    {
+    }
+
+    void setCutoff(uint64_t cutoff)
+    {
+        uint64_t current = _cutoff.load(std::memory_order_relaxed);
+        while (current < cutoff && !_cutoff.compare_exchange_weak(current, cutoff, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    uint64_t cutoff() const
+    {
+        return _cutoff.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @return first key that is not expired
+     */
+    IndexKey cutoffKey() const
+    {
+        const uint64_t cutoff = _cutoff.load(std::memory_order_relaxed);
+        return encodeIndexKey(cutoff < _span ? 0 : cutoff - _span + 1);
+    }
+
+    bool expired(const rocksdb::Slice &key) const
+    {
+        const uint64_t cutoff = _cutoff.load(std::memory_order_relaxed);
+        if (key.size() < sizeof(uint64_t) || cutoff < _span)
+        {
+            return false;
+        }
+        return decodeIndexKey(rocksdb::Slice(key.data(), sizeof(uint64_t))) <= cutoff - _span;
+    }
+
+    Decision FilterV2(int, const rocksdb::Slice &key, ValueType value_type, const rocksdb::Slice &, std::string *, std::string *) const override
+    {
+        if (value_type == kBlobIndex)
+        {
+            return Decision::kKeep;
+        }
+        return expired(key) ? Decision::kRemove : Decision::kKeep;
+    }
+
+    const char *Name() const override
+    {
+        return "RetentionFilter";
+    }
+};
@@ -0,0 +1,214 @@
+#pragma once
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <rocksdb/merge_operator.h>
+#include <rocksdb/options.h>
+#include <rocksdb/slice.h>
+
+/**
+ * @brief Rollup column families hold the min, max, sum and count of the numeric fields per time bucket of one width,
+ * named "rollup/" plus the width. Keys are the big endian bucket start, i.e. the timestamp rounded down to a multiple
+ * of the width. Every timestamped record adds a merge operand to the bucket of each width, RollupMergeOperator folds
+ * them, so ingest never reads the bucket back.
+ */
+constexpr const char *rollupColumnPrefix = "rollup/";
+
+inline std::string rollupColumn(uint64_t width)
+{
+    return rollupColumnPrefix + std::to_string(width);
+}
+
+/**
+ * @brief Bucket widths in timestamp units, the defaults are 1 s, 1 min and 1 h of millisecond timestamps.
+ */
+struct RollupOptions
+{
+    std::vector<uint64_t> widths{1000, 60 * 1000, 60 * 60 * 1000};
+};
+
+struct FieldRollup
+{
+    double min = 0;
+    double max = 0;
+    double sum = 0;
+};
+
+/**
+ * @brief Aggregate of one bucket, fields has one entry per RowDecoder slot of the record type,
+ * i.e. per singular numeric field in declaration order.
+ */
+struct RollupBucket
+{
+    uint64_t start = 0;
+    uint64_t width = 0;
+    uint64_t count = 0;
+    std::vector<FieldRollup> fields;
+
+    double mean(size_t slot) const
+    {
+        return fields[slot].sum / static_cast<double>(count);
+    }
+};
+
+/**
+ * @brief Bucket values are the count followed by min, max and sum of every field, as little endian
+ * 64 bit integer and doubles. A single record is encoded as a bucket of count 1.
+ */
+class RollupCodec
+{
+private:
+    static void putFixed64(std::string &dst, uint64_t value)
+    {
+        for (int shift = 0; shift < 64; shift += 8)
+        {
+            dst.push_back(static_cast<char>(value >> shift));
+        }
+    }
+
+    static void putDouble(std::string &dst, double value)
+    {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        putFixed64(dst, bits);
+    }
+
+    static uint64_t getFixed64(const char *ptr)
+    {
+        uint64_t value = 0;
+        for (int pos = 7; pos >= 0; --pos)
+        {
+            value = (value << 8) | static_cast<uint8_t>(ptr[pos]);
+        }
+        return value;
+    }
+
+    static double getDouble(const char *ptr)
+    {
+        const uint64_t bits = getFixed64(ptr);
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+public:
+    static constexpr size_t fieldSize = 3 * sizeof(double);
+
+    static bool valid(const rocksdb::Slice &value)
+    {
+        return value.size() >= sizeof(uint64_t) && 0 == (value.size() - sizeof(uint64_t)) % fieldSize;
+    }
+
+    static void encodeSample(const double *row, size_t size, std::string &dst)
+    {
+        dst.clear();
+        putFixed64(dst, 1);
+        for (size_t slot = 0; slot < size; ++slot)
+        {
+            putDouble(dst, row[slot]);
+            putDouble(dst, row[slot]);
+            putDouble(dst, row[slot]);
+        }
+    }
+
+    /**
+     * @return false if one of the values is not a bucket or they have different field counts
+     */
+    static bool combine(const rocksdb::Slice &lhs, const rocksdb::Slice &rhs, std::string &dst)
+    {
+        if (!valid(lhs) || lhs.size() != rhs.size())
+        {
+            return false;
+        }
+        dst.clear();
+        putFixed64(dst, getFixed64(lhs.data()) + getFixed64(rhs.data()));
+        for (size_t pos = sizeof(uint64_t); pos < lhs.size(); pos += fieldSize)
+        {
+            const char *left  = lhs.data() + pos;
+            const char *right = rhs.data() + pos;
+            putDouble(dst, std::min(getDouble(left), getDouble(right)));
+            putDouble(dst, std::max(getDouble(left + sizeof(double)), getDouble(right + sizeof(double))));
+            putDouble(dst, getDouble(left + 2 * sizeof(double)) + getDouble(right + 2 * sizeof(double)));
+        }
+        return true;
+    }
+
+    static bool decode(const rocksdb::Slice &value, RollupBucket &bucket)
+    {
+        if (!valid(value))
+        {
+            return false;
+        }
+        bucket.count = getFixed64(value.data());
+        bucket.fields.resize((value.size() - sizeof(uint64_t)) / fieldSize);
+        const char *ptr = value.data() + sizeof(uint64_t);
+        for (FieldRollup &field : bucket.fields)
+        {
+            field.min  = getDouble(ptr);
+            field.max  = getDouble(ptr + sizeof(double));
+            field.sum  = getDouble(ptr + 2 * sizeof(double));
+            ptr       += fieldSize;
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief Folds bucket values and operands, associative, so rocksdb may combine operands before the base value is known.
+ */
+class RollupMergeOperator : public rocksdb::AssociativeMergeOperator
+{
+public:
+    bool Merge(const rocksdb::Slice &, const rocksdb::Slice *existing_value, const rocksdb::Slice &value, std::string *new_value,
+               rocksdb::Logger *) const override
+    {
+        if (!existing_value)
+        {
+            if (!RollupCodec::valid(value))
+            {
+                return false;
+            }
+            new_value->assign(value.data(), value.size());
+            return true;
+        }
+        return RollupCodec::combine(*existing_value, value, *new_value);
+    }
+
+    const char *Name() const override
+    {
+        return "RollupMergeOperator";
+    }
+};
+
+/**
+ * @brief Options of the rollup column families, writer and readers need the merge operator.
+ */
+inline rocksdb::ColumnFamilyOptions rollupOptions()
+{
+    rocksdb::ColumnFamilyOptions options;
+    options.merge_operator = std::make_shared<RollupMergeOperator>();
+    return options;
+}
+
+/**
+ * @return width of a rollup column family name, 0 if the name is no rollup column, e.g. "rollup/abc"
+ */
+inline uint64_t rollupWidth(const std::string &column)
+{
+    const std::string prefix(rollupColumnPrefix);
+    if (column.compare(0, prefix.size(), prefix) != 0)
+    {
+        return 0;
+    }
+    uint64_t width    = 0;
+    const char *first = column.data() + prefix.size();
+    const char *last  = column.data() + column.size();
+    const auto result = std::from_chars(first, last, width);
+    return result.ec == std::errc() && result.ptr == last ? width : 0;
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+
+#include "wireFormat.h"
+
+/**
+ * @brief Decodes the singular scalar fields of a record into a value array, one slot per field in declaration order.
+ * If the message has nothing but singular scalar fields (like the recorder schemas), the wire format is decoded
+ * directly with a field number to slot table, no DynamicMessage and no Reflection is involved.
+ * Any other schema falls back to ParseFromArray and reads the scalar slots through Reflection.
+ */
+class RowDecoder
+{
+private:
+    struct Entry
+    {
+        int32_t slot     = -1;
+        uint8_t wireType = 0;
+        WireKind kind    = WireKind::Int32;
+    };
+
+    // Beyond this field number the table would be mostly holes, such schemas use the generic path
+    static constexpr int maxTableNumber = 1024;
+
+    std::vector<const google::protobuf::FieldDescriptor *> _fields;
+    std::vector<Entry> _table;
+    bool _flat = true;
+    std::unique_ptr<google::protobuf::Message> _msg;
+
+    static bool isScalar(const google::protobuf::FieldDescriptor *field)
+    {
+        using google::protobuf::FieldDescriptor;
+        return !field->is_repeated() && field->cpp_type() != FieldDescriptor::CPPTYPE_STRING &&
+               field->cpp_type() != FieldDescriptor::CPPTYPE_MESSAGE && field->cpp_type() != FieldDescriptor::CPPTYPE_ENUM;
+    }
+
+    static Entry entryFor(int slot, const google::protobuf::FieldDescriptor *field)
+    {
+        Entry entry;
+        entry.slot     = slot;
+        entry.kind     = wireKindOf(field);
+        entry.wireType = wireTypeOf(entry.kind);
+        return entry;
+    }
+
+    template <typename T>
+    bool decodeFlat(const uint8_t *ptr, const uint8_t *end, T *row) const
+    {
+        while (ptr < end)
+        {
+            uint64_t tag = 0;
+            if (!readWireVarint(ptr, end, tag))
+            {
+                return false;
+            }
+            const uint64_t number   = tag >> 3;
+            const uint32_t wireType = static_cast<uint32_t>(tag & 7);
+            if (number < _table.size() && _table[number].slot >= 0 && _table[number].wireType == wireType)
+            {
+                const Entry &entry = _table[number];
+                WireValue value;
+                if (!readWireValue(ptr, end, wireType, value))
+                {
+                    return false;
+                }
+                row[entry.slot] = wireValue<T>(entry.kind, value);
+            }
+            else if (0 == number || !skipWireField(ptr, end, wireType))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template <typename T>
+    bool decodeGeneric(const char *data, size_t size, T *row)
+    {
+        using google::protobuf::FieldDescriptor;
+        if (!_msg->ParseFromArray(data, static_cast<int>(size)))
+        {
+            return false;
+        }
+        const google::protobuf::Reflection *reflection = _msg->GetReflection();
+        for (size_t slot = 0; slot < _fields.size(); ++slot)
+        {
+            const FieldDescriptor *field = _fields[slot];
+            switch (field->cpp_type())
+            {
+            case FieldDescriptor::CPPTYPE_INT32:
+                row[slot] = static_cast<T>(reflection->GetInt32(*_msg, field));
+                break;
+            case FieldDescriptor::CPPTYPE_INT64:
+                row[slot] = static_cast<T>(reflection->GetInt64(*_msg, field));
+                break;
+            case FieldDescriptor::CPPTYPE_UINT32:
+                row[slot] = static_cast<T>(reflection->GetUInt32(*_msg, field));
+                break;
+            case FieldDescriptor::CPPTYPE_UINT64:
+                row[slot] = static_cast<T>(reflection->GetUInt64(*_msg, field));
+                break;
+            case FieldDescriptor::CPPTYPE_FLOAT:
+                row[slot] = static_cast<T>(reflection->GetFloat(*_msg, field));
+                break;
+            case FieldDescriptor::CPPTYPE_DOUBLE:
+                row[slot] = static_cast<T>(reflection->GetDouble(*_msg, field));
+                break;
+            default:
+                row[slot] = static_cast<T>(reflection->GetBool(*_msg, field));
+                break;
+            }
+        }
+        return true;
+    }
+
+public:
+    explicit RowDecoder(const google::protobuf::Message &prototype) : _msg(prototype.New())
+    {
+        const google::protobuf::Descriptor *desc = prototype.GetDescriptor();
+        int maxNumber                            = 0;
+        for (int idx = 0; idx < desc->field_count(); ++idx)
+        {
+            const google::protobuf::FieldDescriptor *field = desc->field(idx);
+            if (isScalar(field))
+            {
+                _fields.push_back(field);
+                maxNumber = std::max(maxNumber, field->number());
+                // proto2 defaults are not known on the wire
+                _flat = _flat && !field->has_default_value();
+            }
+            else
+            {
+                _flat = false;
+            }
+        }
+        _flat = _flat && maxNumber <= maxTableNumber && 0 == desc->extension_range_count() && 0 == desc->oneof_decl_count();
+        if (_flat)
+        {
+            _table.resize(static_cast<size_t>(maxNumber) + 1);
+            for (size_t slot = 0; slot < _fields.size(); ++slot)
+            {
+                _table[_fields[slot]->number()] = entryFor(static_cast<int>(slot), _fields[slot]);
+            }
+        }
+    }
+
+    bool isFlat() const
+    {
+        return _flat;
+    }
+
+    size_t size() const
+    {
+        return _fields.size();
+    }
+
+    const google::protobuf::FieldDescriptor *field(size_t slot) const
+    {
+        return _fields[slot];
+    }
+
+    /**
+     * @return slot of the field or -1 if there is no scalar field with that name
+     */
+    int slot(const std::string &name) const
+    {
+        for (size_t slot = 0; slot < _fields.size(); ++slot)
+        {
+            if (_fields[slot]->name() == name)
+            {
+                return static_cast<int>(slot);
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * @brief Decodes one serialized record into row[0..size()), converting every value to T.
+     * Fields missing on the wire keep the proto3 default 0.
+     * @return false if the buffer is not a valid record
+     */
+    template <typename T>
+    bool decode(const char *data, size_t size, T *row)
+    {
+        std::fill(row, row + _fields.size(), T{});
+        if (_flat)
+        {
+            const uint8_t *ptr = reinterpret_cast<const uint8_t *>(data);
+            return decodeFlat(ptr, ptr + size, row);
+        }
+        return decodeGeneric(data, size, row);
+    }
+};
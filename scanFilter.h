@@ -0,0 +1,367 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <google/protobuf/descriptor.h>
+
+#include "wireFormat.h"
+
+enum class CompareOp : uint8_t
+{
+    Less,
+    LessEqual,
+    Equal,
+    NotEqual,
+    GreaterEqual,
+    Greater
+};
+
+/**
+ * @brief Conjunction of "field op value" clauses on the singular scalar, enum, string and bytes fields of one
+ * message type, evaluated on the serialized record. The record is walked tag by tag: fields without a clause are
+ * skipped by their wire type, only the fields with clauses are decoded. Fields missing on the wire compare with
+ * their default value, repeated occurrences of a field take the last one, like the protobuf parser does.
+ * String and bytes fields only support Equal and NotEqual. The filter is immutable while matching,
+ * so one filter can be used by several threads.
+ */
+class ScanFilter
+{
+private:
+    enum class Domain : uint8_t
+    {
+        Signed,
+        Unsigned,
+        Floating,
+        Bytes,
+        // the value is out of the field's range, the clause has the same result for every record
+        Constant
+    };
+
+    struct Clause
+    {
+        CompareOp op  = CompareOp::Equal;
+        Domain domain = Domain::Signed;
+        int64_t signedValue    = 0;
+        uint64_t unsignedValue = 0;
+        double floatingValue   = 0;
+        bool constantResult    = false;
+        std::string bytesValue;
+    };
+
+    struct Field
+    {
+        uint64_t number  = 0;
+        uint8_t wireType = 0;
+        WireKind kind    = WireKind::Int32;
+        Domain domain    = Domain::Signed;
+        std::vector<size_t> clauses;
+    };
+
+    // one bit per clause in the match mask
+    static constexpr size_t maxClauses = 64;
+
+    const google::protobuf::Descriptor *_desc = nullptr;
+    std::vector<Clause> _clauses;
+    std::vector<Field> _fields;
+    uint64_t _defaultMask = 0;
+    uint64_t _allMask     = 0;
+
+    template <typename T>
+    static bool compare(CompareOp op, const T &lhs, const T &rhs)
+    {
+        switch (op)
+        {
+        case CompareOp::Less:
+            return lhs < rhs;
+        case CompareOp::LessEqual:
+            return lhs <= rhs;
+        case CompareOp::Equal:
+            return lhs == rhs;
+        case CompareOp::NotEqual:
+            return lhs != rhs;
+        case CompareOp::GreaterEqual:
+            return lhs >= rhs;
+        default:
+            return lhs > rhs;
+        }
+    }
+
+    static Domain domainOf(WireKind kind)
+    {
+        switch (kind)
+        {
+        case WireKind::UInt32:
+        case WireKind::UInt64:
+        case WireKind::Bool:
+        case WireKind::Fixed32:
+        case WireKind::Fixed64:
+            return Domain::Unsigned;
+        case WireKind::Float:
+        case WireKind::Double:
+            return Domain::Floating;
+        default:
+            return Domain::Signed;
+        }
+    }
+
+    static bool matchesValue(const Clause &clause, const Field &field, const WireValue &value)
+    {
+        switch (clause.domain)
+        {
+        case Domain::Signed:
+            return compare(clause.op, wireValue<int64_t>(field.kind, value), clause.signedValue);
+        case Domain::Unsigned:
+            return compare(clause.op, wireValue<uint64_t>(field.kind, value), clause.unsignedValue);
+        case Domain::Constant:
+            return clause.constantResult;
+        default:
+            return compare(clause.op, wireValue<double>(field.kind, value), clause.floatingValue);
+        }
+    }
+
+    static bool matchesBytes(const Clause &clause, const uint8_t *data, size_t size)
+    {
+        const bool equal = size == clause.bytesValue.size() && 0 == std::memcmp(data, clause.bytesValue.data(), size);
+        return clause.op == CompareOp::Equal ? equal : !equal;
+    }
+
+    /**
+     * @brief Result of the clause for a record without the field
+     */
+    static bool matchesDefault(const Clause &clause, const google::protobuf::FieldDescriptor *field)
+    {
+        using google::protobuf::FieldDescriptor;
+        switch (field->cpp_type())
+        {
+        case FieldDescriptor::CPPTYPE_STRING:
+            return (field->default_value_string() == clause.bytesValue) == (clause.op == CompareOp::Equal);
+        case FieldDescriptor::CPPTYPE_INT32:
+            return matchesDefaultValue(clause, field->default_value_int32());
+        case FieldDescriptor::CPPTYPE_INT64:
+            return matchesDefaultValue(clause, field->default_value_int64());
+        case FieldDescriptor::CPPTYPE_UINT32:
+            return matchesDefaultValue(clause, field->default_value_uint32());
+        case FieldDescriptor::CPPTYPE_UINT64:
+            return matchesDefaultValue(clause, field->default_value_uint64());
+        case FieldDescriptor::CPPTYPE_FLOAT:
+            return matchesDefaultValue(clause, field->default_value_float());
+        case FieldDescriptor::CPPTYPE_DOUBLE:
+            return matchesDefaultValue(clause, field->default_value_double());
+        case FieldDescriptor::CPPTYPE_BOOL:
+            return matchesDefaultValue(clause, field->default_value_bool());
+        default:
+            return matchesDefaultValue(clause, field->default_value_enum() ? field->default_value_enum()->number() : 0);
+        }
+    }
+
+    template <typename T>
+    static bool matchesDefaultValue(const Clause &clause, T value)
+    {
+        switch (clause.domain)
+        {
+        case Domain::Signed:
+            return compare(clause.op, static_cast<int64_t>(value), clause.signedValue);
+        case Domain::Unsigned:
+            return compare(clause.op, static_cast<uint64_t>(value), clause.unsignedValue);
+        case Domain::Constant:
+            return clause.constantResult;
+        default:
+            return compare(clause.op, static_cast<double>(value), clause.floatingValue);
+        }
+    }
+
+    const google::protobuf::FieldDescriptor *requireField(const std::string &name) const
+    {
+        const google::protobuf::FieldDescriptor *field = _desc->FindFieldByName(name);
+        if (!field || field->is_repeated() || field->cpp_type() == google::protobuf::FieldDescriptor::CPPTYPE_MESSAGE)
+        {
+            throw std::invalid_argument("No singular scalar field " + name + " in " + _desc->full_name());
+        }
+        if (_clauses.size() == maxClauses)
+        {
+            throw std::invalid_argument("Too many clauses for a scan filter");
+        }
+        return field;
+    }
+
+    ScanFilter &addClause(const google::protobuf::FieldDescriptor *descriptor, Clause &&clause)
+    {
+        const size_t pos = _clauses.size();
+        _allMask |= uint64_t(1) << pos;
+        if (matchesDefault(clause, descriptor))
+        {
+            _defaultMask |= uint64_t(1) << pos;
+        }
+        _clauses.push_back(std::move(clause));
+
+        const uint64_t number = static_cast<uint64_t>(descriptor->number());
+        for (Field &field : _fields)
+        {
+            if (field.number == number)
+            {
+                field.clauses.push_back(pos);
+                return *this;
+            }
+        }
+        Field field;
+        field.number = number;
+        if (descriptor->cpp_type() == google::protobuf::FieldDescriptor::CPPTYPE_STRING)
+        {
+            field.wireType = 2;
+            field.domain   = Domain::Bytes;
+        }
+        else
+        {
+            field.kind     = wireKindOf(descriptor);
+            field.wireType = wireTypeOf(field.kind);
+            field.domain   = domainOf(field.kind);
+        }
+        field.clauses.push_back(pos);
+        _fields.push_back(std::move(field));
+        return *this;
+    }
+
+public:
+    explicit ScanFilter(const google::protobuf::Descriptor *desc) : _desc(desc)
+    {
+    }
+
+    const google::protobuf::Descriptor *descriptor() const
+    {
+        return _desc;
+    }
+
+    /**
+     * @brief Adds the clause "field op value" for a numeric, bool or enum field. Integer values are compared as
+     * integers with the field's signedness, a floating point value or field compares as double. An integer out of
+     * the range of the field's signedness, e.g. a negative value for an unsigned field, is below or above every
+     * field value, so the clause folds to a constant.
+     */
+    template <typename T, typename = std::enable_if_t<std::is_arithmetic_v<T>>>
+    ScanFilter &where(const std::string &name, CompareOp op, T value)
+    {
+        const google::protobuf::FieldDescriptor *descriptor = requireField(name);
+        if (descriptor->cpp_type() == google::protobuf::FieldDescriptor::CPPTYPE_STRING)
+        {
+            throw std::invalid_argument("Field " + name + " is not numeric");
+        }
+        Clause clause;
+        clause.op     = op;
+        clause.domain = std::is_floating_point_v<T> ? Domain::Floating : domainOf(wireKindOf(descriptor));
+        clause.signedValue   = static_cast<int64_t>(value);
+        clause.unsignedValue = static_cast<uint64_t>(value);
+        clause.floatingValue = static_cast<double>(value);
+        if constexpr (std::is_integral_v<T> && std::is_signed_v<T>)
+        {
+            if (clause.domain == Domain::Unsigned && value < 0)
+            {
+                // every field value is greater
+                clause.domain         = Domain::Constant;
+                clause.constantResult = compare(op, 1, 0);
+            }
+        }
+        else if constexpr (std::is_integral_v<T>)
+        {
+            if (clause.domain == Domain::Signed && static_cast<uint64_t>(value) > static_cast<uint64_t>(INT64_MAX))
+            {
+                // every field value is less
+                clause.domain         = Domain::Constant;
+                clause.constantResult = compare(op, 0, 1);
+            }
+        }
+        return addClause(descriptor, std::move(clause));
+    }
+
+    /**
+     * @brief Adds the clause "field == value" or "field != value" for a string or bytes field.
+     */
+    ScanFilter &where(const std::string &name, CompareOp op, const std::string &value)
+    {
+        const google::protobuf::FieldDescriptor *descriptor = requireField(name);
+        if (descriptor->cpp_type() != google::protobuf::FieldDescriptor::CPPTYPE_STRING || (op != CompareOp::Equal && op != CompareOp::NotEqual))
+        {
+            throw std::invalid_argument("Field " + name + " only supports string equality");
+        }
+        Clause clause;
+        clause.op         = op;
+        clause.domain     = Domain::Bytes;
+        clause.bytesValue = value;
+        return addClause(descriptor, std::move(clause));
+    }
+
+    ScanFilter &where(const std::string &name, CompareOp op, const char *value)
+    {
+        return where(name, op, std::string(value));
+    }
+
+    size_t size() const
+    {
+        return _clauses.size();
+    }
+
+    /**
+     * @return true if the serialized record satisfies every clause, an empty filter matches every record
+     * @throw std::invalid_argument if the record is not valid wire format
+     */
+    bool matches(const char *data, size_t size) const
+    {
+        uint64_t mask      = _defaultMask;
+        const uint8_t *ptr = reinterpret_cast<const uint8_t *>(data);
+        const uint8_t *end = ptr + size;
+        while (ptr < end)
+        {
+            uint64_t tag = 0;
+            if (!readWireVarint(ptr, end, tag))
+            {
+                throw std::invalid_argument("Error while parsing");
+            }
+            const uint64_t number   = tag >> 3;
+            const uint32_t wireType = static_cast<uint32_t>(tag & 7);
+            const Field *field      = nullptr;
+            for (const Field &candidate : _fields)
+            {
+                if (candidate.number == number && candidate.wireType == wireType)
+                {
+                    field = &candidate;
+                    break;
+                }
+            }
+            bool valid = true;
+            if (!field)
+            {
+                valid = 0 != number && skipWireField(ptr, end, wireType);
+            }
+            else if (field->domain == Domain::Bytes)
+            {
+                const uint8_t *bytes = nullptr;
+                size_t length        = 0;
+                valid                = readWireBytes(ptr, end, bytes, length);
+                for (size_t pos = 0; valid && pos < field->clauses.size(); ++pos)
+                {
+                    const uint64_t bit = uint64_t(1) << field->clauses[pos];
+                    mask               = matchesBytes(_clauses[field->clauses[pos]], bytes, length) ? mask | bit : mask & ~bit;
+                }
+            }
+            else
+            {
+                WireValue value;
+                valid = readWireValue(ptr, end, wireType, value);
+                for (size_t pos = 0; valid && pos < field->clauses.size(); ++pos)
+                {
+                    const uint64_t bit = uint64_t(1) << field->clauses[pos];
+                    mask               = matchesValue(_clauses[field->clauses[pos]], *field, value) ? mask | bit : mask & ~bit;
+                }
+            }
+            if (!valid)
+            {
+                throw std::invalid_argument("Error while parsing");
+            }
+        }
+        return mask == _allMask;
+    }
+};
@@ -0,0 +1,175 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/dynamic_message.h>
+#include <google/protobuf/io/tokenizer.h>
+#include <google/protobuf/io/zero_copy_stream_impl.h>
+
+#include <google/protobuf/compiler/parser.h>
+
+#include <desc.pb.h>
+
+inline google::protobuf::FileDescriptorProto parseSchemaText(const std::string &text)
+{
+    using namespace google::protobuf;
+    using namespace google::protobuf::io;
+    using namespace google::protobuf::compiler;
+
+    ArrayInputStream raw_input(text.data(), static_cast<int>(text.size()));
+    Tokenizer input(&raw_input, NULL);
+
+    // Proto definition to a representation as used by the protobuf lib:
+    /* FileDescriptorProto documentation:
+     * A valid .proto file can be translated directly to a FileDescriptorProto
+     * without any other information (e.g. without reading its imports).
+     * */
+    FileDescriptorProto file_desc_proto;
+    Parser parser;
+    if (!parser.Parse(&input, &file_desc_proto))
+    {
+        throw std::invalid_argument("Error while parsing schema");
+    }
+
+    // Set the name in file_desc_proto as Parser::Parse does not do this.
+    // Every schema gets its own pool, so the name only has to be unique there.
+    if (!file_desc_proto.has_name())
+    {
+        file_desc_proto.set_name("measDescription.proto");
+    }
+    return file_desc_proto;
+}
+
+/**
+ * @brief A built FileDescriptor together with the pool owning it and a factory caching the message prototypes.
+ */
+class CompiledSchema
+{
+private:
+    google::protobuf::DescriptorPool _pool;
+    mutable google::protobuf::DynamicMessageFactory _factory;
+    const google::protobuf::FileDescriptor *_file = nullptr;
+    std::string _fileProto;
+
+public:
+    explicit CompiledSchema(const google::protobuf::FileDescriptorProto &proto)
+    {
+        // Construct our own FileDescriptor for the proto file:
+        /* FileDescriptor documentation:
+         * Describes a whole .proto file.  To get the FileDescriptor for a compiled-in
+         * file, get the descriptor for something defined in that file and call
+         * descriptor->file().  Use DescriptorPool to construct your own descriptors.
+         * */
+        _file = _pool.BuildFile(proto);
+        if (!_file)
+        {
+            throw std::invalid_argument("Error while building schema " + proto.name());
+        }
+        proto.SerializeToString(&_fileProto);
+    }
+
+    CompiledSchema(const CompiledSchema &) = delete;
+    CompiledSchema &operator=(const CompiledSchema &) = delete;
+
+    const google::protobuf::FileDescriptor *file() const
+    {
+        return _file;
+    }
+
+    /**
+     * @brief Serialized FileDescriptorProto, persisted in msgDesc::measDescriptorProto
+     */
+    const std::string &fileDescriptorProto() const
+    {
+        return _fileProto;
+    }
+
+    const google::protobuf::Descriptor *findMessageType(const std::string &message_type) const
+    {
+        return _file->FindMessageTypeByName(message_type);
+    }
+
+    const google::protobuf::Message *prototype(const google::protobuf::Descriptor *desc) const
+    {
+        return _factory.GetPrototype(desc);
+    }
+};
+
+/**
+ * @brief Process wide cache of compiled schemas, keyed by the content of the schema.
+ * A schema is either the .proto text or its serialized FileDescriptorProto. The latter
+ * only needs a BuildFile on a miss, the protoc Parser is not involved.
+ * Entries are never evicted, descriptors stay valid for the whole process.
+ */
+class SchemaCache
+{
+private:
+    std::mutex _mtx;
+    std::unordered_map<std::string, std::shared_ptr<const CompiledSchema>> _byText;
+    std::unordered_map<std::string, std::shared_ptr<const CompiledSchema>> _byProto;
+
+    SchemaCache() = default;
+
+    std::shared_ptr<const CompiledSchema> insert(const google::protobuf::FileDescriptorProto &proto)
+    {
+        auto schema = std::make_shared<const CompiledSchema>(proto);
+        auto it     = _byProto.emplace(schema->fileDescriptorProto(), schema).first;
+        return it->second;
+    }
+
+public:
+    static SchemaCache &instance()
+    {
+        static SchemaCache cache;
+        return cache;
+    }
+
+    std::shared_ptr<const CompiledSchema> fromText(const std::string &text)
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        auto it = _byText.find(text);
+        if (it != _byText.end())
+        {
+            return it->second;
+        }
+        auto schema = insert(parseSchemaText(text));
+        _byText.emplace(text, schema);
+        return schema;
+    }
+
+    std::shared_ptr<const CompiledSchema> fromFileDescriptorProto(const std::string &serialized)
+    {
+        std::lock_guard<std::mutex> lock(_mtx);
+        auto it = _byProto.find(serialized);
+        if (it != _byProto.end())
+        {
+            return it->second;
+        }
+        google::protobuf::FileDescriptorProto proto;
+        if (!proto.ParseFromString(serialized))
+        {
+            throw std::invalid_argument("Error while parsing FileDescriptorProto");
+        }
+        auto schema = insert(proto);
+        _byProto.emplace(serialized, schema);
+        return schema;
+    }
+
+    /**
+     * @brief Prefers the persisted FileDescriptorProto, falls back to the text for older databases.
+     */
+    std::shared_ptr<const CompiledSchema> fromDesc(const msgDesc &desc)
+    {
+        if (!desc.measdescriptorproto().empty())
+        {
+            return fromFileDescriptorProto(desc.measdescriptorproto());
+        }
+        return fromText(desc.measdescription());
+    }
+};
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include <rocksdb/db.h>
+#include <rocksdb/filter_policy.h>
+#include <rocksdb/slice_transform.h>
+#include <rocksdb/table.h>
+
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/message.h>
+
+#include <desc.pb.h>
+
+#include "keyCodec.h"
+#include "schemaCache.h"
+
+/**
+ * @brief Options of the typed record column family: the schema id is the prefix, prefix bloom filters in the
+ * memtable and the table files let point reads and scans of one type skip the data of the other types.
+ * Writer and readers open the column family with these options.
+ */
+inline rocksdb::ColumnFamilyOptions typedRecordOptions()
+{
+    rocksdb::ColumnFamilyOptions options;
+    options.prefix_extractor.reset(rocksdb::NewFixedPrefixTransform(schemaIdSize));
+    options.memtable_prefix_bloom_size_ratio = 0.1;
+    rocksdb::BlockBasedTableOptions tableOptions;
+    tableOptions.filter_policy.reset(rocksdb::NewBloomFilterPolicy(10));
+    // point reads use the whole key filter, scans the prefix filter
+    tableOptions.whole_key_filtering = true;
+    options.table_factory.reset(rocksdb::NewBlockBasedTableFactory(tableOptions));
+    return options;
+}
+
+struct RegisteredSchema
+{
+    uint32_t id = 0;
+    std::shared_ptr<const CompiledSchema> schema;
+    const google::protobuf::Descriptor *desc = nullptr;
+
+    const google::protobuf::Message &prototype() const
+    {
+        return *schema->prototype(desc);
+    }
+};
+
+/**
+ * @brief Message types stored in one database, each with a compact id used as key prefix of its records.
+ * The entries are msgDesc values in the desc column family under "schema/" plus the big endian id, holding the
+ * compiled FileDescriptorProto and the message type. Ids start at 1 and are never reused; registering a changed
+ * schema of a known message type gives it a new id, find(messageType) returns the latest one.
+ */
+class SchemaRegistry
+{
+private:
+    std::map<uint32_t, RegisteredSchema> _byId;
+    std::unordered_map<std::string, uint32_t> _latestByName;
+
+public:
+    static constexpr const char *keyPrefix = "schema/";
+
+    static std::string key(uint32_t id)
+    {
+        const TypedKey typedKey = encodeTypedKey(id, 0);
+        return keyPrefix + std::string(typedKey.data(), schemaIdSize);
+    }
+
+    /**
+     * @brief Compiles the schema of the entry, the compiled schemas are shared through the SchemaCache.
+     */
+    const RegisteredSchema &add(const msgDesc &entry)
+    {
+        RegisteredSchema registered;
+        registered.id     = entry.schemaid();
+        registered.schema = SchemaCache::instance().fromDesc(entry);
+        registered.desc   = registered.schema->findMessageType(entry.messagetype());
+        if (0 == registered.id || !registered.desc)
+        {
+            throw std::invalid_argument("Invalid schema registry entry " + std::to_string(entry.schemaid()) + " " + entry.messagetype());
+        }
+        auto latest = _latestByName.find(entry.messagetype());
+        if (latest == _latestByName.end() || latest->second < registered.id)
+        {
+            _latestByName[entry.messagetype()] = registered.id;
+        }
+        return _byId[registered.id] = std::move(registered);
+    }
+
+    /**
+     * @brief Replaces the registry with the entries stored in the desc column family.
+     */
+    void load(rocksdb::DB *db, rocksdb::ColumnFamilyHandle *descHandle)
+    {
+        _byId.clear();
+        _latestByName.clear();
+        const std::string prefix(keyPrefix);
+        std::unique_ptr<rocksdb::Iterator> iter(db->NewIterator(rocksdb::ReadOptions(), descHandle));
+        for (iter->Seek(prefix); iter->Valid() && iter->key().starts_with(prefix); iter->Next())
+        {
+            msgDesc entry;
+            if (!entry.ParseFromArray(iter->value().data(), static_cast<int>(iter->value().size())))
+            {
+                throw std::invalid_argument("Error while parsing");
+            }
+            add(entry);
+        }
+        if (!iter->status().ok())
+        {
+            throw std::invalid_argument(iter->status().ToString());
+        }
+    }
+
+    /**
+     * @return nullptr if the id is not registered
+     */
+    const RegisteredSchema *find(uint32_t id) const
+    {
+        auto it = _byId.find(id);
+        return it == _byId.end() ? nullptr : &it->second;
+    }
+
+    /**
+     * @return latest schema of the message type, nullptr if there is none
+     */
+    const RegisteredSchema *find(const std::string &messageType) const
+    {
+        auto it = _latestByName.find(messageType);
+        return it == _latestByName.end() ? nullptr : find(it->second);
+    }
+
+    const RegisteredSchema &require(uint32_t id) const
+    {
+        const RegisteredSchema *registered = find(id);
+        if (!registered)
+        {
+            throw std::invalid_argument("Schema " + std::to_string(id) + " not registered");
+        }
+        return *registered;
+    }
+
+    uint32_t nextId() const
+    {
+        return _byId.empty() ? 1 : _byId.rbegin()->first + 1;
+    }
+
+    size_t size() const
+    {
+        return _byId.size();
+    }
+
+    std::map<uint32_t, RegisteredSchema>::const_iterator begin() const
+    {
+        return _byId.begin();
+    }
+
+    std::map<uint32_t, RegisteredSchema>::const_iterator end() const
+    {
+        return _byId.end();
+    }
+};
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+#include <rocksdb/db.h>
+#include <rocksdb/write_batch.h>
+
+#include <google/protobuf/message.h>
+
+#include "keyCodec.h"
+
+/**
+ * @brief Key codecs of TypedStore: the column family is a compile time constant, encode is constexpr and returns
+ * the key bytes by value, so a key never touches the heap.
+ */
+struct IndexKeyCodec
+{
+    using Key = uint64_t;
+
+    static constexpr const char *column = "default";
+
+    static constexpr IndexKey encode(Key index)
+    {
+        return encodeIndexKey(index);
+    }
+
+    static Key decode(const rocksdb::Slice &key)
+    {
+        return decodeIndexKey(key);
+    }
+};
+
+/**
+ * @brief Records of one registered schema in the typed record column, see SchemaRegistry.
+ */
+template <uint32_t SchemaId>
+struct SchemaKeyCodec
+{
+    using Key = uint64_t;
+
+    static constexpr const char *column = typedRecordColumn;
+
+    static constexpr TypedKey encode(Key index)
+    {
+        return encodeTypedKey(SchemaId, index);
+    }
+
+    static Key decode(const rocksdb::Slice &key)
+    {
+        return decodeTypedKey(key).second;
+    }
+};
+
+/**
+ * @brief Named entries of the desc column, like the msgDesc values of DBCreator::writeDesc.
+ * A decoded key points into the iterator and is only valid during the callback.
+ */
+struct DescKeyCodec
+{
+    using Key = std::string_view;
+
+    static constexpr const char *column = "desc";
+
+    static constexpr std::string_view encode(Key name)
+    {
+        return name;
+    }
+
+    static Key decode(const rocksdb::Slice &key)
+    {
+        return std::string_view(key.data(), key.size());
+    }
+};
+
+/**
+ * @brief Read and write path for a generated message type Msg, the compile time counterpart of the dynamic
+ * Message API. Keys are encoded on the stack, records are serialized with ByteSizeLong and
+ * SerializeWithCachedSizesToArray into a reused buffer and parsed from a reused pinned value. Generated classes
+ * are final, so the calls on Msg are devirtualized and can be inlined. The records are wire compatible with the
+ * dynamic API, e.g. DBReader::ReadMsg can read what a TypedStore<Msg, IndexKeyCodec> wrote.
+ * Not thread safe, use one store per thread.
+ * Get one from DBCreator::typedStore or DBReader::OpenTypedStore; it must not outlive them.
+ */
+template <typename Msg, typename KeyCodec>
+class TypedStore
+{
+    static_assert(std::is_base_of_v<google::protobuf::Message, Msg> && !std::is_same_v<google::protobuf::Message, Msg>,
+                  "TypedStore needs a generated message type");
+
+private:
+    rocksdb::DB *_db                     = nullptr;
+    rocksdb::ColumnFamilyHandle *_handle = nullptr;
+    rocksdb::WriteOptions _writeOptions;
+    std::string _buffer;
+    rocksdb::PinnableSlice _pinned;
+
+    template <typename Encoded>
+    static rocksdb::Slice keySlice(const Encoded &key)
+    {
+        return rocksdb::Slice(key.data(), key.size());
+    }
+
+    const std::string &serialize(const Msg &msg)
+    {
+        const size_t size = msg.ByteSizeLong();
+        _buffer.resize(size);
+        msg.SerializeWithCachedSizesToArray(reinterpret_cast<uint8_t *>(&_buffer[0]));
+        return _buffer;
+    }
+
+public:
+    using Key = typename KeyCodec::Key;
+
+    TypedStore(rocksdb::DB *db, rocksdb::ColumnFamilyHandle *handle, bool disableWAL = true) : _db(db), _handle(handle)
+    {
+        if (!_db || !_handle)
+        {
+            throw std::invalid_argument(std::string("Column family ") + KeyCodec::column + " not found");
+        }
+        _writeOptions.disableWAL = disableWAL;
+    }
+
+    void put(Key key, const Msg &msg)
+    {
+        const auto encoded     = KeyCodec::encode(key);
+        rocksdb::Status status = _db->Put(_writeOptions, _handle, keySlice(encoded), serialize(msg));
+        if (!status.ok())
+        {
+            throw std::invalid_argument(status.ToString());
+        }
+    }
+
+    /**
+     * @brief Adds the record to a caller owned batch, e.g. to commit many records at once.
+     */
+    void put(rocksdb::WriteBatch &batch, Key key, const Msg &msg)
+    {
+        const auto encoded = KeyCodec::encode(key);
+        batch.Put(_handle, keySlice(encoded), serialize(msg));
+    }
+
+    void write(rocksdb::WriteBatch &batch)
+    {
+        rocksdb::Status status = _db->Write(_writeOptions, &batch);
+        if (!status.ok())
+        {
+            throw std::invalid_argument(status.ToString());
+        }
+    }
+
+    /**
+     * @throw std::invalid_argument if the record is missing or can't be parsed
+     */
+    void get(Key key, Msg &msg)
+    {
+        const auto encoded     = KeyCodec::encode(key);
+        rocksdb::Status status = _db->Get(rocksdb::ReadOptions(), _handle, keySlice(encoded), &_pinned);
+        if (!status.ok())
+        {
+            throw std::invalid_argument(status.ToString());
+        }
+        const bool parsed = msg.ParseFromArray(_pinned.data(), static_cast<int>(_pinned.size()));
+        _pinned.Reset();
+        if (!parsed)
+        {
+            throw std::invalid_argument("Error while parsing");
+        }
+    }
+
+    Msg get(Key key)
+    {
+        Msg msg;
+        get(key, msg);
+        return msg;
+    }
+
+    /**
+     * @brief Parses every record in [startKey, endKey) into msg and calls callback(key, msg), by ascending key.
+     * @return number of visited records
+     */
+    template <typename Callback>
+    size_t scan(Key startKey, Key endKey, Msg &msg, Callback &&callback)
+    {
+        const auto start = KeyCodec::encode(startKey);
+        const auto end   = KeyCodec::encode(endKey);
+        const rocksdb::Slice upperBound(keySlice(end));
+        rocksdb::ReadOptions options;
+        options.iterate_upper_bound = &upperBound;
+
+        size_t ctr = 0;
+        std::unique_ptr<rocksdb::Iterator> iter(_db->NewIterator(options, _handle));
+        for (iter->Seek(keySlice(start)); iter->Valid(); iter->Next())
+        {
+            if (!msg.ParseFromArray(iter->value().data(), static_cast<int>(iter->value().size())))
+            {
+                throw std::invalid_argument("Error while parsing");
+            }
+            callback(KeyCodec::decode(iter->key()), static_cast<const Msg &>(msg));
+            ++ctr;
+        }
+        if (!iter->status().ok())
+        {
+            throw std::invalid_argument(iter->status().ToString());
+        }
+        return ctr;
+    }
+};
@@ -0,0 +1,232 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <google/protobuf/descriptor.h>
+
+/**
+ * @brief Helpers to read singular scalar fields straight from the protobuf wire format, shared by RowDecoder and ScanFilter.
+ * Readers return false on truncated or malformed input and advance ptr behind what they consumed.
+ */
+enum class WireKind : uint8_t
+{
+    Int32,
+    Int64,
+    UInt32,
+    UInt64,
+    SInt32,
+    SInt64,
+    Bool,
+    Fixed32,
+    SFixed32,
+    Float,
+    Fixed64,
+    SFixed64,
+    Double
+};
+
+/**
+ * @brief Enums are read as Int32, string, bytes and message fields are not scalar and map to Double.
+ */
+inline WireKind wireKindOf(const google::protobuf::FieldDescriptor *field)
+{
+    using google::protobuf::FieldDescriptor;
+    switch (field->type())
+    {
+    case FieldDescriptor::TYPE_INT32:
+    case FieldDescriptor::TYPE_ENUM:
+        return WireKind::Int32;
+    case FieldDescriptor::TYPE_INT64:
+        return WireKind::Int64;
+    case FieldDescriptor::TYPE_UINT32:
+        return WireKind::UInt32;
+    case FieldDescriptor::TYPE_UINT64:
+        return WireKind::UInt64;
+    case FieldDescriptor::TYPE_SINT32:
+        return WireKind::SInt32;
+    case FieldDescriptor::TYPE_SINT64:
+        return WireKind::SInt64;
+    case FieldDescriptor::TYPE_BOOL:
+        return WireKind::Bool;
+    case FieldDescriptor::TYPE_FIXED32:
+        return WireKind::Fixed32;
+    case FieldDescriptor::TYPE_SFIXED32:
+        return WireKind::SFixed32;
+    case FieldDescriptor::TYPE_FLOAT:
+        return WireKind::Float;
+    case FieldDescriptor::TYPE_FIXED64:
+        return WireKind::Fixed64;
+    case FieldDescriptor::TYPE_SFIXED64:
+        return WireKind::SFixed64;
+    default:
+        return WireKind::Double;
+    }
+}
+
+inline uint8_t wireTypeOf(WireKind kind)
+{
+    switch (kind)
+    {
+    case WireKind::Fixed32:
+    case WireKind::SFixed32:
+    case WireKind::Float:
+        return 5;
+    case WireKind::Fixed64:
+    case WireKind::SFixed64:
+    case WireKind::Double:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+inline bool readWireVarint(const uint8_t *&ptr, const uint8_t *end, uint64_t &value)
+{
+    if (ptr < end && *ptr < 0x80)
+    {
+        value = *ptr++;
+        return true;
+    }
+    value = 0;
+    for (int shift = 0; shift < 64 && ptr < end; shift += 7)
+    {
+        const uint8_t byte = *ptr++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if (byte < 0x80)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename Int>
+bool readWireFixed(const uint8_t *&ptr, const uint8_t *end, Int &value)
+{
+    if (end - ptr < static_cast<ptrdiff_t>(sizeof(Int)))
+    {
+        return false;
+    }
+    value = 0;
+    for (size_t pos = 0; pos < sizeof(Int); ++pos)
+    {
+        value |= static_cast<Int>(ptr[pos]) << (8 * pos);
+    }
+    ptr += sizeof(Int);
+    return true;
+}
+
+/**
+ * @brief Reads a length delimited field (wire type 2) without copying, data points into the buffer.
+ */
+inline bool readWireBytes(const uint8_t *&ptr, const uint8_t *end, const uint8_t *&data, size_t &size)
+{
+    uint64_t length = 0;
+    if (!readWireVarint(ptr, end, length) || static_cast<uint64_t>(end - ptr) < length)
+    {
+        return false;
+    }
+    data = ptr;
+    size = static_cast<size_t>(length);
+    ptr += length;
+    return true;
+}
+
+inline bool skipWireField(const uint8_t *&ptr, const uint8_t *end, uint32_t wireType)
+{
+    uint64_t length = 0;
+    switch (wireType)
+    {
+    case 0:
+        return readWireVarint(ptr, end, length);
+    case 1:
+        length = 8;
+        break;
+    case 2:
+        if (!readWireVarint(ptr, end, length))
+        {
+            return false;
+        }
+        break;
+    case 5:
+        length = 4;
+        break;
+    default:
+        // groups are not supported
+        return false;
+    }
+    if (static_cast<uint64_t>(end - ptr) < length)
+    {
+        return false;
+    }
+    ptr += length;
+    return true;
+}
+
+/**
+ * @brief Raw value of a scalar field, only the member of the field's wire type is set.
+ */
+struct WireValue
+{
+    uint64_t varint  = 0;
+    uint32_t fixed32 = 0;
+    uint64_t fixed64 = 0;
+};
+
+inline bool readWireValue(const uint8_t *&ptr, const uint8_t *end, uint32_t wireType, WireValue &value)
+{
+    switch (wireType)
+    {
+    case 0:
+        return readWireVarint(ptr, end, value.varint);
+    case 5:
+        return readWireFixed(ptr, end, value.fixed32);
+    default:
+        return readWireFixed(ptr, end, value.fixed64);
+    }
+}
+
+/**
+ * @brief Converts the raw value of a field of the given kind to T.
+ */
+template <typename T>
+T wireValue(WireKind kind, const WireValue &value)
+{
+    switch (kind)
+    {
+    case WireKind::Int32:
+        return static_cast<T>(static_cast<int32_t>(value.varint));
+    case WireKind::Int64:
+        return static_cast<T>(static_cast<int64_t>(value.varint));
+    case WireKind::UInt32:
+        return static_cast<T>(static_cast<uint32_t>(value.varint));
+    case WireKind::UInt64:
+        return static_cast<T>(value.varint);
+    case WireKind::SInt32:
+        return static_cast<T>(static_cast<int32_t>((static_cast<uint32_t>(value.varint) >> 1) ^ (~(static_cast<uint32_t>(value.varint) & 1) + 1)));
+    case WireKind::SInt64:
+        return static_cast<T>(static_cast<int64_t>((value.varint >> 1) ^ (~(value.varint & 1) + 1)));
+    case WireKind::Bool:
+        return static_cast<T>(value.varint != 0);
+    case WireKind::Fixed32:
+        return static_cast<T>(value.fixed32);
+    case WireKind::SFixed32:
+        return static_cast<T>(static_cast<int32_t>(value.fixed32));
+    case WireKind::Float: {
+        float result;
+        std::memcpy(&result, &value.fixed32, sizeof(result));
+        return static_cast<T>(result);
+    }
+    case WireKind::Fixed64:
+        return static_cast<T>(value.fixed64);
+    case WireKind::SFixed64:
+        return static_cast<T>(static_cast<int64_t>(value.fixed64));
+    default: {
+        double result;
+        std::memcpy(&result, &value.fixed64, sizeof(result));
+        return static_cast<T>(result);
+    }
+    }
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief Fixed set of threads working off a FIFO of tasks. submit() hands back a future,
+ * which also carries an exception thrown by the task. The destructor finishes the queued tasks.
+ * Tasks must not wait for other tasks of the same pool, they could all end up waiting.
+ */
+class WorkerPool
+{
+private:
+    std::vector<std::thread> _threads;
+    std::mutex _mtx;
+    std::condition_variable _cv;
+    std::deque<std::function<void()>> _tasks;
+    bool _stop = false;
+
+    void run()
+    {
+        for (;;)
+        {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(_mtx);
+                _cv.wait(lock, [this]() { return _stop || !_tasks.empty(); });
+                if (_tasks.empty())
+                {
+                    return;
+                }
+                task = std::move(_tasks.front());
+                _tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+public:
+    explicit WorkerPool(size_t threads = std::max(1u, std::thread::hardware_concurrency()))
+    {
+        for (size_t ctr = 0; ctr < std::max<size_t>(1, threads); ++ctr)
+        {
+            _threads.emplace_back([this]() { run(); });
+        }
+    }
+
+    ~WorkerPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            _stop = true;
+        }
+        _cv.notify_all();
+        for (auto &thread : _threads)
+        {
+            thread.join();
+        }
+    }
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    size_t size() const
+    {
+        return _threads.size();
+    }
+
+    template <typename Task>
+    std::future<std::invoke_result_t<Task>> submit(Task &&task)
+    {
+        // std::function needs a copyable target, the packaged_task is shared
+        auto packaged = std::make_shared<std::packaged_task<std::invoke_result_t<Task>()>>(std::forward<Task>(task));
+        std::future<std::invoke_result_t<Task>> result = packaged->get_future();
+        {
+            std::lock_guard<std::mutex> lock(_mtx);
+            _tasks.emplace_back([packaged]() { (*packaged)(); });
+        }
+        _cv.notify_one();
+        return result;
+    }
+};